@@ -3,13 +3,15 @@
 ** Author: Thomas Hollenberg
 ** Date: 1/20/2017
 ** Description: Text-based adventure game.
-** Input: User must enter 1 or 2 to make decisions.
+** Input: User must enter 1 or 2 to make decisions. Optionally pass
+**   "--seed <s>" to replay the same cave layout and luck.
 ** Output: Text narration of gameplay.
 *********************************************************************/
 
 #include <iostream>
-#include <ctime>
+#include <cstring>
 #include <cstdlib>
+#include "../Common/random.h"
 
 using namespace std;
 
@@ -66,16 +68,18 @@ void create_dungeon_map(Platform *d_map) {
 ** Function: shuffle_obstacles
 ** Description: Randomizes the element ordering of the obstacle_numbering
 **              array so that each playthrough of the game is unique.
-** Parameters: int *obs_numbering
+**              Uses a Fisher-Yates shuffle, so every ordering is equally
+**              likely.
+** Parameters: int *obs_numbering, RandomStream *rng
 ** Pre-Conditions: obs_numbering is an array containing at least 14 elements
 **                 (additional elements will not be shuffled).
 ** Post-Conditions: The elements of obs_numbering have been permuted.
 ** Return: N/A
 *********************************************************************/
-void shuffle_obstacles(int *obs_numbering) {
+void shuffle_obstacles(int *obs_numbering, RandomStream *rng) {
     int temp, rand_num;
-    for (int i = 0; i < 14; ++i) {
-        rand_num = rand() % 14;
+    for (int i = 13; i > 0; --i) {
+        rand_num = random_below(rng, i + 1);
         temp = obs_numbering[i];
         obs_numbering[i] = obs_numbering[rand_num];
         obs_numbering[rand_num] = temp;
@@ -136,14 +140,14 @@ int get_user_input(string prompt) {
 ** Function: play_game
 ** Description: Outputs text narrating game events and prompts the user for
 **              input to make decisions.
-** Parameters: Platform *d_map
+** Parameters: Platform *d_map, RandomStream *rng
 ** Pre-Conditions: d_map is an array containing at least 10 elements and
 **                 all of the Platform and const Obstacle pointers of each
 **                 Platform object in d_map have been correctly assigned.
 ** Post-Conditions: The user has won the game or given up.
 ** Return: N/A
 *********************************************************************/
-void play_game(Platform *d_map) {
+void play_game(Platform *d_map, RandomStream *rng) {
     int user_choice, user_luck;
     Platform *const entrance = &d_map[0];
     Platform *const treasure = &d_map[9];
@@ -151,7 +155,7 @@ void play_game(Platform *d_map) {
 
     cout << "\nYou enter the cave.\n";
     while (current_platform != treasure) {
-        user_luck = rand() % 100;
+        user_luck = random_below(rng, 100);
 
 		if (current_platform == entrance) {
 			cout << "\nYou orient yourself towards the back of the cave.\nTo your right you see " << current_platform->obs_straight->description << endl;
@@ -208,7 +212,7 @@ void play_game(Platform *d_map) {
          << "    |_____________________|/\n\n";
 }
 
-int main() {
+int main(int argc, char *argv[]) {
 	// Contains the predefined obstacle set.
 	const Obstacle OBSTACLE_LIBRARY[] = {
 		{ "a rope hanging from the ceiling. It looks like you could swing across, if you had to.", 55,
@@ -242,7 +246,8 @@ int main() {
 	};
     int obstacle_numbering[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
 
-    srand(time(NULL)); // seed random number generator
+    // seed random number generator
+    RandomStream rng = make_stream((argc == 3 && !strcmp(argv[1], "--seed")) ? strtoull(argv[2], 0, 10) : time_seed());
 
 	Platform dungeon_map[10];
     create_dungeon_map(dungeon_map);
@@ -261,9 +266,9 @@ int main() {
          << "***********************************************************************************************************************\n";
 
     do {
-        shuffle_obstacles(obstacle_numbering);
+        shuffle_obstacles(obstacle_numbering, &rng);
         assign_obstacles(dungeon_map, obstacle_numbering, OBSTACLE_LIBRARY);
-        play_game(dungeon_map);
+        play_game(dungeon_map, &rng);
     } while (get_user_input("Would you like to play again (Play Again: 1, Quit: 2)? ") != 2);
 
     return 0;
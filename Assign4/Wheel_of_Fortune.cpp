@@ -4,77 +4,663 @@
 ** Date: 02/8/2017
 ** Description: Phrase guessing game based on the television game show
 **   Wheel of Fortune.
-** Input: N/A
-** Output: Gameplay text.
+** Input: N/A. Optionally pass "--seed <s>" to replay the same spins.
+**   "--simulate <rounds> --corpus <file>" instead plays that many rounds
+**   between computer players, one phrase per line of the corpus, on
+**   "--threads <n>" threads. "--bots <name,name,...>" seats the players
+**   (default "frequency,greedy,random") and "--vowel-price <n>" sets the
+**   cost of a vowel. "--candidates <board> --corpus <file>" lists every
+**   corpus phrase that fits a board such as "_he Qu_c_ ___", given the
+**   letters already called with "--guessed <letters>". "--bank <file>"
+**   draws the interactive game's phrases from a phrase file instead of
+**   asking for them. "--tournament <players> --corpus <file>" runs a
+**   knockout tournament of bots (seated from "--bots" in turn) at tables
+**   of "--table-size <n>" (default 4) playing "--rounds <n>" (default 3)
+**   rounds each, and prints the "--top <k>" (default 10) standings and,
+**   with "--rank <player>", that player's place. "--wheel <file>"
+**   replaces the standard wheel (0 to 20 points per letter, bankrupt,
+**   and lose a turn, all equally likely) in every mode; see load_wheel
+**   for the file format. "--log <file>" records every spin, letter,
+**   vowel, and solve attempt of the interactive game or of a simulation
+**   to a binary event log. "--replay <file>" plays a log back without
+**   any input, and "--log-stats <file>" summarizes it. "--host <list>"
+**   runs one interactive game per input named in the list file (one
+**   path per line: a script, a named pipe, or "-" for stdin), all at
+**   once in one thread, answering each game as its input arrives; with
+**   "--bank" the phrases are drawn from the bank instead of read.
+** Output: Gameplay text, or win rates, average scores, and throughput
+**   per seat in simulation mode, or the matching phrases and the query
+**   time in candidate mode, or the play-by-play or summary of a log.
+**   Hosted games print the same text as the interactive game, echoing
+**   their input, with each line tagged with the game's number.
 *********************************************************************/
 
 #include <iostream>
 #include <string>       // for string objects
 #include <sstream>      // for stringstream objects
 #include <cassert>      // for assert()
-#include <cmath>        // for ceil()
-#include <cstdlib>      // for rand(), srand(), system()
-#include <ctime>        // for time()
-#include <algorithm>    // for swap()
+#include <cmath>        // for ceil(), log2()
+#include <cstdlib>      // for strtoull()
+#include <cstring>      // for strcmp(), memchr()
+#include <cstdio>       // for fopen(), fwrite()
+#include <fstream>      // for ifstream
+#include <algorithm>    // for swap(), sort(), min(), max()
+#include <iomanip>      // for setw(), setprecision()
+#include <vector>       // for vector
+#include <thread>       // for thread
+#include <chrono>       // for steady_clock
+#include <unordered_map> // for unordered_map
+#include <atomic>       // for atomic
+#include <mutex>        // for mutex, lock_guard
+#include <stdint.h>     // for uint32_t, uint64_t
+#include <sys/mman.h>   // for mmap(), munmap()
+#include <sys/stat.h>   // for fstat()
+#include <fcntl.h>      // for open()
+#include <unistd.h>     // for close(), write(), isatty()
+#include <sys/ioctl.h>  // for ioctl(), winsize
+#include <sys/resource.h> // for setrlimit()
+#include <poll.h>       // for poll()
+#include <cerrno>       // for errno
+#ifdef __SSE2__
+#include <emmintrin.h>  // for SSE2 intrinsics
+#endif
+#include "../Common/random.h"
+#include "../Common/alias.h"
 
 #define INT_MAX 2147483647
 #define LETTERS_IN_ALPHABET 26
 #define NUM_VOWELS 5
+#define WHEEL_WEDGES 22
+#define BANKRUPT 0
+#define LOSE_TURN 21
+#define WEDGE_POINTS 0
+#define WEDGE_BANKRUPT 1
+#define WEDGE_LOSE_TURN 2
+#define VOWEL_PRICE 10
+#define STANDINGS_SHOWN 10
+#define BITMAP_GROUP_SIZE 64
+#define BITMAP_MAX_BYTES (16 << 20)
+#define ROW_EMPTY 0xffffffffu
+#define ROW_NONE 0xfffffffeu
+#define LETTER_DEPTH 4
+#define COUNTER_PLANES 8
+#define LOG_MAGIC 0x4c464f57
+#define LOG_VERSION 1
+#define LOG_FLUSH_BYTES 65536
+#define EVENT_ROUND 1
+#define EVENT_TURN 2
+#define EVENT_SPIN 3
+#define EVENT_CONSONANT 4
+#define EVENT_VOWEL 5
+#define EVENT_SOLVE 6
+#define STATUS_ROW 1
+#define BOARD_ROW 3
+#define HOST_READ_SIZE 4096
+#define HOST_MAX_PLAYERS 100
+#define HOST_MAX_ROUNDS 100
+#define ASK_PLAYERS 0
+#define ASK_ROUNDS 1
+#define ASK_PHRASE 2
+#define ASK_ACTION 3
+#define ASK_CONSONANT 4
+#define ASK_VOWEL 5
+#define ASK_SOLUTION 6
+#define GAME_OVER 7
 
 using namespace std;
 
+// A player's number is given out by whoever seats the players (from 1
+// within each game), so any number of games can run side by side.
 struct Player {
-    static int counter;
-    int number;
-    int total_score ;
+    int number {};
+    int total_score {};
+    int round_score {};
+};
+
+// Players ordered by total score, highest first, with ties in player
+// order. rank[i] is the position of player i in order, so a rank query
+// is one lookup and the top k players are the first k entries, however
+// many players there are.
+struct Standings {
+    const Player *players {};
+    vector<int> order;
+    vector<int> rank;
+};
+
+// A secret phrase prepared for play. The positions of each letter are
+// stored together (those of the i-th letter of the alphabet run from
+// positions[start[i]] up to positions[start[i + 1]]), so revealing a
+// letter only touches its own occurrences, and hidden counts the
+// letters still censured on the board, so the puzzle is solved exactly
+// when it reaches zero.
+struct Puzzle {
+    string answer;
+    string board;
+    vector<int> positions;
+    int start[LETTERS_IN_ALPHABET + 1];
+    int hidden;
+};
+
+// A bank of valid phrases loaded in bulk. Phrase i is the bytes of text
+// from offsets[i] up to offsets[i + 1], and the same bytes of boards
+// hold it already censured, so it can go on the board (or be used as
+// its own shape) without another pass.
+struct PhraseStore {
+    string text;
+    string boards;
+    vector<size_t> offsets;
+};
+
+// The valid lines one loader thread found in its chunk of a phrase file.
+struct PhraseChunk {
+    string text;
+    string boards;
+    vector<size_t> ends;
+    long long rejected {};
+};
+
+// Every phrase of one shape (the phrase with its letters censured, so
+// word lengths and punctuation must match). Groups large enough to be
+// worth it also keep bitmaps over their members, so that the revealed
+// letters of a board can be matched with a few word-wide ANDs instead
+// of a comparison per phrase. rows maps each position and letter to
+// its bitmap in position_bits: only letters that occur at a position
+// get one (ROW_EMPTY otherwise), and once a group's bitmaps reach
+// BITMAP_MAX_BYTES the remaining positions get none (ROW_NONE) and are
+// left to the full check.
+struct ShapeGroup {
+    vector<int> phrases;
+    vector<uint32_t> letters;
+    int words {};
+    vector<uint32_t> rows;
+    vector<uint64_t> position_bits;
+};
+
+// Candidate-phrase index over a dictionary of phrases. letter_depth
+// holds LETTER_DEPTH masks per phrase: bit i of mask k is set when the
+// i-th letter of the alphabet appears more than k times in the phrase.
+struct PhraseIndex {
+    const PhraseStore *store {};
+    unordered_map<string, ShapeGroup> shapes;
+    vector<uint32_t> letter_depth;
+};
+
+// How good a letter would be to call next, over a set of candidates.
+struct LetterScore {
+    char letter;
+    double probability;
+    double reveals;
+    double gain;
+};
+
+// The phrases of an index that fit a board, given the guessed letters,
+// and the unguessed letters ranked over them. A smart bot's action,
+// letter, and solve attempt all look at the same board, so each thread
+// keeps the last analysis and only redoes it when the board changes.
+struct BoardAnalysis {
+    const PhraseIndex *index {};
+    string board;
+    uint32_t guessed {};
+    vector<int> candidates;
+    vector<LetterScore> ranking;
+};
+
+// Everything a computer player may look at when it picks its next move:
+// the board and the guess history, but never the answer. index is the
+// candidate index over the corpus, or a null pointer if none was built.
+struct TurnView {
+    const string *board;
+    const int *alphabet;
+    int c_guessed;
+    int v_guessed;
+    int hidden;
     int round_score;
+    int vowel_price;
+    const PhraseIndex *index;
+};
 
-    Player() {
-        number = ++counter;
-        total_score = 0;
-        round_score = 0;
-    }
+// A computer player. choose_action returns the same numbers take_turn
+// asks a person for: spin (1), solve (2), or buy a vowel (3).
+// choose_letter picks an unguessed vowel or consonant. Bots cannot type
+// a solution, so a solve attempt succeeds when at most solve_skill
+// letters are still hidden, or when only vowels are left to fill in. A
+// bot with a negative solve_skill instead names the first phrase in the
+// index that fits the board, and is right only if that is the answer.
+struct Strategy {
+    const char *name;
+    int solve_skill;
+    int (*choose_action)(const TurnView&, RandomStream*);
+    char (*choose_letter)(const TurnView&, bool, RandomStream*);
+};
+
+// A knockout tournament between bots. Player i is played by
+// bots[i % bots.size()]; round_wins counts the rounds each player won.
+// The last group of fields is filled in by run_tournament.
+struct Tournament {
+    const PhraseStore *corpus {};
+    const PhraseIndex *index {};
+    vector<const Strategy*> bots;
+    int rounds {};
+    int vowel_price {};
+    uint64_t seed {};
+    vector<Player> players;
+    vector<int> round_wins;
+    Standings standings;
+
+    int stages {};
+    int tables_played {};
+    int champion {};
+    double seconds {};
+};
+
+// One stage of a tournament: the players at each table, each table's
+// winner, and the points and rounds every player won during the stage.
+struct Stage {
+    vector<vector<int> > tables;
+    vector<int> winners;
+    vector<long long> points;
+    vector<int> round_wins;
+};
+
+// Per-seat results of a simulation run.
+struct BotStats {
+    long long rounds {};
+    long long turns {};
+    vector<long long> wins;
+    vector<long long> winnings;
+    vector<long long> round_points;
+};
+
+// The wheel's wedges: each is worth value points per letter found
+// (kind WEDGE_POINTS) or is a bankrupt or lose-a-turn wedge. Spins are
+// drawn from the alias table over the wedge weights, in constant time
+// however many wedges the wheel has.
+struct Wheel {
+    vector<int> value;
+    vector<int> kind;
+    vector<uint32_t> threshold;
+    vector<int> alias;
+};
+
+// The wheel every game spins. It is set up in main before any game
+// starts and only read afterwards, so all threads share it.
+Wheel wheel;
+
+// On-disk layout of an event log: a LogHeader followed by a stream of
+// events, each a kind byte followed by its fields as varints (seven bits
+// per byte, lowest first, with the high bit set on all but the last):
+//   EVENT_ROUND      players, vowel price, phrase length, phrase bytes
+//   EVENT_TURN       player, counted from 0
+//   EVENT_SPIN       wedge kind, points per letter
+//   EVENT_CONSONANT  letter, number revealed
+//   EVENT_VOWEL      letter, number revealed
+//   EVENT_SOLVE      1 if the solution was right, 0 if not
+// A round always ends on the turn of the player who won it, and its
+// events are written together, so any round can be read back from its
+// own EVENT_ROUND onwards.
+struct LogHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+// The log file every thread of a run writes its rounds to.
+struct LogFile {
+    FILE *file {};
+    mutex lock;
+};
+
+// One thread's events that have not been written to the log file yet.
+struct EventLog {
+    LogFile *out {};
+    vector<unsigned char> bytes;
+};
+
+// A read-only, memory-mapped view of an event log.
+struct LogView {
+    const unsigned char *events {};
+    const unsigned char *end {};
+    void *map {};
+    size_t map_size {};
+};
+
+// One event read back from a log. For EVENT_ROUND, a, b, and c are the
+// players, vowel price, and phrase length and text points at the phrase
+// inside the log; otherwise a and b are the event's fields in order.
+struct LogEvent {
+    int kind;
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+    const char *text;
+};
+
+// The round being read back from a log: every player's round score,
+// whose turn it is, and the points of their last spin.
+struct LogRound {
+    vector<int> score;
+    int vowel_price {};
+    int player {};
+    int spin {};
+};
+
+// What the terminal shows during a round: a status line and the board,
+// pinned to the top of the screen above a scrolling region for prompts
+// and messages. Changes are queued in out as cursor moves and text (a
+// reveal only rewrites the cells of the letter revealed) and sent in
+// one write per frame by flush_screen. When output is not a terminal,
+// or the board does not fit, nothing is pinned and take_turn prints the
+// board as text instead.
+struct Screen {
+    bool tty {};
+    bool drawn {};
+    int width {};
+    int height {};
+    int rows {};
+    int round {};
+    int rounds {};
+    string out;
+};
+
+// One game run by run_host. Everything play_game and take_turn keep on
+// the stack between prompts is kept here instead, so that thousands of
+// games can wait on their input at once without a thread each: state is
+// the prompt the game is waiting on (one of the ASK_ values, or
+// GAME_OVER), guessed has bit i set once the i-th letter of the alphabet
+// was called this round, and spin is the points per letter of the
+// current player's last spin. input holds what has been read from fd
+// but not yet used, and output what the game has printed but the host
+// has not yet written.
+struct HostedGame {
+    int fd {-1};
+    int number {};
+    uint8_t state {};
+    uint8_t c_guessed {};
+    uint8_t v_guessed {};
+    int round {};
+    int num_r {};
+    int turn {};
+    int spin {};
+    uint32_t guessed {};
+    RandomStream rng;
+    vector<Player> players;
+    vector<string> phrases;
+    Puzzle puzzle;
+    string input;
+    string output;
 };
 
-int Player::counter = 0;
+// The stream random_spin() draws from; each thread owns its own.
+thread_local RandomStream wheel_rng;
+
+// Where this thread records game events, or a null pointer if the run
+// is not being logged.
+thread_local EventLog *game_log;
 
 /** Function Prototypes **/
-void game_setup(int*, int*, Player**, string**);
+void game_setup(int*, int*, Player**, string**, const PhraseStore*);
 int get_integer(const string&, int max_input = INT_MAX);
 string to_string(int);
 string get_phrase(const string&);
 bool check_phrase_validity(const string&);
+bool valid_phrase(const char*, size_t);
+bool valid_mark(const char*, size_t, size_t);
 bool is_alphabetic(char);
 
-void play_game(int, int, Player*, string*);
+void play_game(int, int, Player*, string*, Standings*);
+void init_screen(Screen*);
+void clear_screen();
+void draw_round(Screen*, const Puzzle&);
+void show_status(Screen*, const Player&);
+void reveal_cells(Screen*, const Puzzle&, char);
+void cursor_to(string*, int, int);
+void flush_screen(Screen*);
+void send_screen(Screen*);
+void close_screen(Screen*);
 int censure_phrase(string&);
-bool take_turn(Player&, string&, const string&, int*, int&, int&);
-bool spin_wheel(Player&, string&, const string&, int*, int&);
+void prepare_puzzle(const string&, Puzzle*);
+void store_puzzle(const PhraseStore*, size_t, Puzzle*);
+void index_puzzle(Puzzle*);
+bool take_turn(Player&, Puzzle&, int*, int&, int&, Screen*);
+bool spin_wheel(Player&, Puzzle&, int*, int&, Screen*);
 bool random_spin(Player&, int&);
+void default_wheel(Wheel*);
+bool load_wheel(const char*, Wheel*);
+void add_wedge(Wheel*, int, int);
+void finish_wheel(Wheel*, const vector<double>&);
+int spin_wedge(const Wheel*, RandomStream*);
+bool open_log_file(const char*, LogFile*);
+void close_log_file(LogFile*);
+void flush_events(EventLog*);
+void put_varint(EventLog*, uint64_t);
+void log_round(const string&, int, int);
+void log_turn(int);
+void log_spin(int, int);
+void log_letter(char, int);
+void log_solve(bool);
+bool open_log_view(const char*, LogView*);
+void close_log_view(LogView*);
+bool get_varint(const unsigned char**, const unsigned char*, uint64_t*);
+bool next_event(const unsigned char**, const unsigned char*, LogEvent*);
+bool score_event(const LogEvent&, LogRound*);
+bool replay_log(const LogView*);
+bool print_log_stats(const LogView*);
 bool solve_puzzle(const string&);
 bool case_insensitive_compare(const string&, const string&);
-void buy_vowel(Player&, string&, const string&, int*, int&);
+void buy_vowel(Player&, Puzzle&, int*, int&, Screen*);
 char get_letter(int*, bool);
 bool is_vowel(int);
-int decode_phrase(string&, const string&, char);
+int decode_phrase(Puzzle&, char);
 void print_guess_result(Player&, int, char);
 void reset_guess_history(int*, int&, int&);
 
-void declare_winner(int, Player*);
-int print_standings(int, Player*, bool);
-void sort_by_total_score(int, Player**);
+void declare_winner(const Standings*, ostream &out = cout);
+int print_standings(const Standings*, bool, ostream &out = cout);
+void init_standings(Standings*, int, const Player*);
+void sort_standings(Standings*);
+void update_standing(Standings*, int);
+bool ranks_above(const Standings*, int, int);
 
+const char* find_option(int, char**, const char*);
 
-int main() {
+bool load_phrase_store(const char*, int, PhraseStore*);
+void scan_phrases(const char*, const char*, PhraseChunk*);
+size_t phrase_count(const PhraseStore*);
+string store_phrase(const PhraseStore*, size_t);
+bool parse_bots(const char*, vector<const Strategy*>&);
+double run_bot_simulation(long long, int, uint64_t, const PhraseStore&, const vector<const Strategy*>&, int, LogFile*,
+                          BotStats*);
+void simulate_rounds(long long, RandomStream, const PhraseStore*, const vector<const Strategy*>*, int,
+                     const PhraseIndex*, LogFile*, BotStats*);
+int play_bot_round(const PhraseStore*, size_t, const vector<const Strategy*>&, int, int, const PhraseIndex*, int*,
+                   long long*);
+bool bot_turn(const Strategy*, int&, Puzzle&, int*, int&, int&, int, const PhraseIndex*);
+bool solve_from_index(const TurnView&, const string&);
+void print_bot_report(const vector<const Strategy*>&, const BotStats*, double);
+bool uses_index(const vector<const Strategy*>&);
+
+void run_tournament(Tournament*, int, int);
+void seat_stage(const Tournament*, const vector<int>&, int, Stage*);
+void play_tables(const Tournament*, Stage*, int, atomic<int>*);
+void print_tournament_report(const Tournament*, int, int);
+
+bool run_host(const char*, const PhraseStore*, uint64_t);
+void start_game(HostedGame*);
+void feed_game(HostedGame*, const string&, const PhraseStore*);
+void next_turn(HostedGame*);
+void end_hosted_round(HostedGame*);
+void prompt_game(HostedGame*);
+bool parse_integer(const string&, int, int*);
+void write_game_output(HostedGame*, string*);
+
+int random_action(const TurnView&, RandomStream*);
+int frequency_action(const TurnView&, RandomStream*);
+int greedy_action(const TurnView&, RandomStream*);
+char random_letter(const TurnView&, bool, RandomStream*);
+char frequency_letter(const TurnView&, bool, RandomStream*);
+int smart_action(const TurnView&, RandomStream*);
+char smart_letter(const TurnView&, bool, RandomStream*);
+
+void build_phrase_index(const PhraseStore&, PhraseIndex*);
+string phrase_shape(const string&);
+uint32_t letter_set(const char*, size_t);
+int find_candidates(const PhraseIndex*, const string&, const int*, vector<int>*);
+bool matches_board(const char*, const string&, uint32_t);
+void print_candidates(const PhraseStore&, const char*, const char*);
+
+void count_letters(const uint32_t*, size_t, long long*);
+void rank_letters(const PhraseIndex*, const vector<int>&, const int*, vector<LetterScore>*);
+bool better_letter(const LetterScore&, const LetterScore&);
+LetterScore best_letter(const TurnView&, bool);
+const BoardAnalysis& analyze_board(const TurnView&);
+
+const Strategy STRATEGIES[] = {
+    {"random", 1, random_action, random_letter},
+    {"frequency", 3, frequency_action, frequency_letter},
+    {"greedy", 2, greedy_action, frequency_letter},
+    {"smart", -1, smart_action, smart_letter},
+};
+const int NUM_STRATEGIES = sizeof(STRATEGIES) / sizeof(STRATEGIES[0]);
+
+
+int main(int argc, char *argv[]) {
     int num_players, num_rounds;
     Player *player;
     string *phrase;
 
-    srand(time(NULL));
+    const char *seed = find_option(argc, argv, "--seed");
+    uint64_t seed_value = (seed ? strtoull(seed, 0, 10) : time_seed());
+    wheel_rng = make_stream(seed_value);
+
+    const char *wheel_path = find_option(argc, argv, "--wheel");
+    if (!wheel_path)
+        default_wheel(&wheel);
+    else if (!load_wheel(wheel_path, &wheel)) {
+        cout << "Could not load a wheel from " << wheel_path << endl;
+        return 0;
+    }
+
+    const char *threads = find_option(argc, argv, "--threads");
+    int num_threads = (threads ? atoi(threads) : thread::hardware_concurrency());
+
+    const char *replay = find_option(argc, argv, "--replay"), *summary = find_option(argc, argv, "--log-stats");
+    if (replay || summary) {
+        LogView view;
+        bool read = open_log_view(replay ? replay : summary, &view);
+        if (!read)
+            cout << "Could not read an event log from " << (replay ? replay : summary) << endl;
+        else if (!(replay ? replay_log(&view) : print_log_stats(&view)))
+            cout << "The event log is damaged; it was read up to the first bad event.\n";
+        close_log_view(&view);
+        return 0;
+    }
+
+    const char *log_path = find_option(argc, argv, "--log");
+    LogFile log_file;
+    if (log_path && !open_log_file(log_path, &log_file)) {
+        cout << "Could not create the event log " << log_path << endl;
+        return 0;
+    }
+
+    const char *board = find_option(argc, argv, "--candidates");
+    if (board) {
+        const char *corpus_path = find_option(argc, argv, "--corpus"), *guessed = find_option(argc, argv, "--guessed");
+        PhraseStore corpus;
+        if (!corpus_path || !load_phrase_store(corpus_path, num_threads, &corpus)) {
+            cout << "A phrase corpus with at least one valid phrase is required (--corpus <file>).\n";
+            return 0;
+        }
+        print_candidates(corpus, board, guessed ? guessed : "");
+        return 0;
+    }
+
+    const char *entrants = find_option(argc, argv, "--tournament");
+    if (entrants) {
+        const char *corpus_path = find_option(argc, argv, "--corpus"), *bots = find_option(argc, argv, "--bots");
+        const char *price = find_option(argc, argv, "--vowel-price"), *table_size = find_option(argc, argv, "--table-size");
+        const char *rounds = find_option(argc, argv, "--rounds"), *top = find_option(argc, argv, "--top");
+        const char *rank = find_option(argc, argv, "--rank");
+        PhraseStore corpus;
+        PhraseIndex index;
+        Tournament tournament;
+        if (!corpus_path || !load_phrase_store(corpus_path, num_threads, &corpus)) {
+            cout << "A phrase corpus with at least one valid phrase is required (--corpus <file>).\n";
+            return 0;
+        }
+        if (!parse_bots(bots ? bots : "frequency,greedy,random", tournament.bots)) {
+            cout << "Unknown bot. Available bots:";
+            for (int i = 0; i < NUM_STRATEGIES; ++i)
+                cout << ' ' << STRATEGIES[i].name;
+            cout << endl;
+            return 0;
+        }
+        if (uses_index(tournament.bots)) {
+            build_phrase_index(corpus, &index);
+            tournament.index = &index;
+        }
+        tournament.corpus = &corpus;
+        tournament.rounds = max(rounds ? atoi(rounds) : 3, 1);
+        tournament.vowel_price = (price ? atoi(price) : VOWEL_PRICE);
+        tournament.seed = seed_value;
+        tournament.players.resize(max(atoi(entrants), 1));
+        for (size_t i = 0; i < tournament.players.size(); ++i)
+            tournament.players[i].number = i + 1;
+        run_tournament(&tournament, max(table_size ? atoi(table_size) : 4, 2), num_threads);
+        print_tournament_report(&tournament, top ? atoi(top) : STANDINGS_SHOWN, rank ? atoi(rank) : 0);
+        return 0;
+    }
+
+    const char *rounds = find_option(argc, argv, "--simulate");
+    if (rounds) {
+        const char *corpus_path = find_option(argc, argv, "--corpus"), *bots = find_option(argc, argv, "--bots");
+        const char *price = find_option(argc, argv, "--vowel-price");
+        PhraseStore corpus;
+        vector<const Strategy*> seats;
+        if (!corpus_path || !load_phrase_store(corpus_path, num_threads, &corpus)) {
+            cout << "A phrase corpus with at least one valid phrase is required (--corpus <file>).\n";
+            return 0;
+        }
+        if (!parse_bots(bots ? bots : "frequency,greedy,random", seats)) {
+            cout << "Unknown bot. Available bots:";
+            for (int i = 0; i < NUM_STRATEGIES; ++i)
+                cout << ' ' << STRATEGIES[i].name;
+            cout << endl;
+            return 0;
+        }
+        BotStats stats;
+        double seconds = run_bot_simulation(atoll(rounds), num_threads, seed_value, corpus, seats,
+                                            price ? atoi(price) : VOWEL_PRICE, log_path ? &log_file : 0, &stats);
+        close_log_file(&log_file);
+        print_bot_report(seats, &stats, seconds);
+        return 0;
+    }
+
+    const char *bank_path = find_option(argc, argv, "--bank");
+    PhraseStore bank;
+    if (bank_path && !load_phrase_store(bank_path, num_threads, &bank)) {
+        cout << "Could not load any valid phrases from " << bank_path << endl;
+        return 0;
+    }
+
+    const char *host = find_option(argc, argv, "--host");
+    if (host) {
+        if (!run_host(host, bank_path ? &bank : 0, seed_value))
+            cout << "Could not read the list of game inputs " << host << endl;
+        return 0;
+    }
+
+    EventLog events;
+    events.out = &log_file;
+    if (log_path)
+        game_log = &events;
 
-    game_setup(&num_players, &num_rounds, &player, &phrase);
-    play_game(num_players, num_rounds, player, phrase);
-    declare_winner(num_players, player);
+    game_setup(&num_players, &num_rounds, &player, &phrase, bank_path ? &bank : 0);
+    Standings standings;
+    init_standings(&standings, num_players, player);
+    play_game(num_players, num_rounds, player, phrase, &standings);
+    declare_winner(&standings);
+    if (log_path)
+        flush_events(&events);
+    close_log_file(&log_file);
 
     // Deallocate memory.
     delete[] phrase;
@@ -97,8 +683,11 @@ int main() {
 **               point to the array of players.
 **             string **r - a pointer to a string pointer that will point
 **               to the array of secret phrases.
-** Pre-Conditions: N/A
-** Post-Conditions: num_p points to an integer from 1-3, num_r
+**             const PhraseStore *bank - phrases to draw the secret
+**               phrases from at random, or a null pointer to ask for
+**               each one.
+** Pre-Conditions: bank, if given, holds at least one phrase.
+** Post-Conditions: num_p points to a positive integer, num_r
 **   points to a positive integer, p points to a Player pointer pointing
 **   to a Player array of length num_p with each element's total_score
 **   and round_score initialized to 0, and r points to a string pointer
@@ -106,18 +695,22 @@ int main() {
 **   phrases.
 ** Return: N/A
 *********************************************************************/
-void game_setup(int *num_p, int *num_r, Player **p, string **r) {
-    system("clear");
+void game_setup(int *num_p, int *num_r, Player **p, string **r, const PhraseStore *bank) {
+    clear_screen();
     cout << "Wheel of Fortune Game Setup:\n";
-    *num_p = get_integer("How many players (1-3)? ", 3);
+    *num_p = get_integer("How many players? ");
     *num_r = get_integer("How many rounds? ");
 
     *p = new Player[*num_p];
+    for (int i = 0; i < *num_p; ++i)
+        (*p)[i].number = i + 1;
     *r = new string[*num_r];
 
     for (int i = 0; i < *num_r; ++i)
-        (*r)[i] = get_phrase("Enter round " + to_string(i + 1) + " phrase: ");
-    system("clear");
+        if (bank)
+            (*r)[i] = store_phrase(bank, random_below(&wheel_rng, phrase_count(bank)));
+        else (*r)[i] = get_phrase("Enter round " + ::to_string(i + 1) + " phrase: ");
+    clear_screen();
 }
 
 /*********************************************************************
@@ -195,29 +788,72 @@ string get_phrase(const string &prompt) {
 ** Return: True if the phrase is valid, false otherwise.
 *********************************************************************/
 bool check_phrase_validity(const string &s) {
-    bool letter = false;
-    for (int i = 0; i < s.length(); ++i) {
-        if (is_alphabetic(s[i]) || s[i] == ' ') {
-            if (s[i] != ' ')
-                letter = true;
-            continue;
-        }
-        if (i && is_alphabetic(s[i-1])) {
-            if (i == s.length() - 1 && (s[i] == '.' || s[i] == '!' || s[i] == '?'))
-                continue;
-            if (i != s.length() - 1 && s[i+1] == ' ' && (s[i] == ',' || s[i] == ';' || s[i] == ':'))
-                continue;
-            if (i != s.length() - 1 && s[i] == '-' && is_alphabetic(s[i+1]))
-                continue;
-        }
-        if (s[i] == '\'' && ((i && is_alphabetic(s[i-1])) || (i != s.length() - 1 && is_alphabetic(s[i+1]))))
-            continue;
+    return valid_phrase(s.data(), s.length());
+}
 
-        return false;
+/*********************************************************************
+** Function: valid_phrase
+** Description: The check behind check_phrase_validity. Letters and
+**   spaces are always allowed, so with SSE2 the phrase is classified 16
+**   characters at a time and only the remaining characters (punctuation
+**   and anything invalid) are looked at one by one, by valid_mark.
+** Parameters: const char *s - the phrase to be checked.
+**             size_t length - the number of characters in s.
+** Pre-Conditions: s has length characters.
+** Post-Conditions: N/A
+** Return: True if the phrase is valid, false otherwise.
+*********************************************************************/
+bool valid_phrase(const char *s, size_t length) {
+    bool letter = false;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i case_bit = _mm_set1_epi8(0x20), before_a = _mm_set1_epi8('a' - 1);
+    const __m128i after_z = _mm_set1_epi8('z' + 1), space = _mm_set1_epi8(' ');
+    for (; i + 16 <= length; i += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + i)), folded = _mm_or_si128(c, case_bit);
+        int letters = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(folded, before_a), _mm_cmplt_epi8(folded, after_z)));
+        int others = ~(letters | _mm_movemask_epi8(_mm_cmpeq_epi8(c, space))) & 0xFFFF;
+        letter |= (letters != 0);
+        for (; others; others &= others - 1)
+            if (!valid_mark(s, length, i + __builtin_ctz(others)))
+                return false;
+    }
+#endif
+    for (; i < length; ++i) {
+        if (is_alphabetic(s[i]))
+            letter = true;
+        else if (s[i] != ' ' && !valid_mark(s, length, i))
+            return false;
     }
     return letter;
 }
 
+/*********************************************************************
+** Function: valid_mark
+** Description: Checks one character of a phrase that is neither a letter
+**   nor a space: a . ! or ? may end the phrase after a letter, a , ; or
+**   : may follow a letter before a space, a - may join two letters, and
+**   an apostrophe must touch a letter.
+** Parameters: const char *s - the phrase.
+**             size_t length - the number of characters in s.
+**             size_t i - the position of the character to check.
+** Pre-Conditions: i is less than length.
+** Post-Conditions: N/A
+** Return: True if the character is allowed where it is, false otherwise.
+*********************************************************************/
+bool valid_mark(const char *s, size_t length, size_t i) {
+    bool after_letter = (i && is_alphabetic(s[i-1])), last = (i == length - 1);
+    if (after_letter) {
+        if (last && (s[i] == '.' || s[i] == '!' || s[i] == '?'))
+            return true;
+        if (!last && s[i+1] == ' ' && (s[i] == ',' || s[i] == ';' || s[i] == ':'))
+            return true;
+        if (!last && s[i] == '-' && is_alphabetic(s[i+1]))
+            return true;
+    }
+    return s[i] == '\'' && (after_letter || (!last && is_alphabetic(s[i+1])));
+}
+
 /*********************************************************************
 ** Function: is_alphabetic
 ** Description: Determines whether or not the character is a letter of
@@ -234,42 +870,239 @@ bool is_alphabetic(char c) {
 /*********************************************************************
 ** Function: play_game
 ** Description: Orchestrates the wheel of fortune game, determines when
-**   each round is over, and keeps track of player scores.
+**   each round is over, and keeps track of player scores. The greeting
+**   and each round's result and standings are held back until the next
+**   round's board is drawn, so that clearing the screen for the new
+**   board never erases them before they can be read.
 ** Parameters: int num_p - the number of players.
 **             int num_r - the number of rounds to be played.
 **             Player *p - a pointer to a Player array of length num_p.
 **             string *r - a pointer to the string array of length
 **               num_r containing the secret phrases.
-** Pre-Conditions: num_p is from 1-3, num_r is a positive
-**   integer, p is a Player array of length num_p, and r is an array
-**   of valid phrases of length num_r.
+**             Standings *standings - the standings of the players in p.
+** Pre-Conditions: num_p is a positive integer, num_r is a positive
+**   integer, p is a Player array of length num_p, r is an array of
+**   valid phrases of length num_r, and standings was set up for p by
+**   init_standings.
 ** Post-Conditions: The total_score variable of every Player in p has
-**   been updated.
+**   been updated, and standings reflects the new totals.
 ** Return: N/A
 *********************************************************************/
-void play_game(int num_p, int num_r, Player *p, string *r) {
+void play_game(int num_p, int num_r, Player *p, string *r, Standings *standings) {
     int turn = -1, alphabet[LETTERS_IN_ALPHABET] = {}, c_guessed = 0, v_guessed = 0;
     bool solved;
-    string board_state;
+    Puzzle puzzle;
+    Screen screen;
+    init_screen(&screen);
+    screen.rounds = num_r;
+    ostringstream results;
 
-    cout << "Let's play, Wheel of Fortune!";
+    results << "Let's play, Wheel of Fortune!";
     for (int i = 0; i < num_r; ++i) {
         solved = false;
 		reset_guess_history(alphabet, c_guessed, v_guessed);
-        board_state = r[i];
-        censure_phrase(board_state);
+        prepare_puzzle(r[i], &puzzle);
         for (int j = 0; j < num_p; ++j)
             p[j].round_score = 0;
 
-        cout << "\n\nRound " << (i + 1) << ":\n\n";
+        screen.round = i + 1;
+        draw_round(&screen, puzzle);
+        cout << results.str() << "\n\nRound " << (i + 1) << ":\n\n";
+        results.str("");
+        log_round(r[i], num_p, VOWEL_PRICE);
         while (!solved) {
             turn++;
-            solved = take_turn(p[turn % num_p], board_state, r[i], alphabet, c_guessed, v_guessed);
+            log_turn(turn % num_p);
+            solved = take_turn(p[turn % num_p], puzzle, alphabet, c_guessed, v_guessed, &screen);
         }
-        cout << "Player " << p[turn % num_p].number << " won Round " << (i + 1) << ", accumulating " << p[turn % num_p].round_score << " points.\n";
+        results << "Player " << p[turn % num_p].number << " won Round " << (i + 1) << ", accumulating " << p[turn % num_p].round_score << " points.\n";
         p[turn % num_p].total_score += p[turn % num_p].round_score;
+        update_standing(standings, turn % num_p);
         if (i != num_r - 1)
-            print_standings(num_p, p, false);
+            print_standings(standings, false, results);
+    }
+    cout << results.str();
+    close_screen(&screen);
+}
+
+/*********************************************************************
+** Function: init_screen
+** Description: Checks whether output goes to a terminal, and how big it
+**   is, so that rounds can be pinned to the top of it.
+** Parameters: Screen *screen - the screen to set up.
+** Pre-Conditions: N/A
+** Post-Conditions: screen is ready for draw_round.
+** Return: N/A
+*********************************************************************/
+void init_screen(Screen *screen) {
+    winsize size;
+    screen->tty = isatty(STDOUT_FILENO) && !ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) && size.ws_col > 0;
+    if (screen->tty) {
+        screen->width = size.ws_col;
+        screen->height = size.ws_row;
+    }
+    screen->out.reserve(256);
+}
+
+/*********************************************************************
+** Function: clear_screen
+** Description: Clears the terminal with an escape sequence, without
+**   starting a shell to run "clear". Does nothing when output is not a
+**   terminal.
+** Parameters: N/A
+** Pre-Conditions: N/A
+** Post-Conditions: The screen is blank with the cursor at the top left.
+** Return: N/A
+*********************************************************************/
+void clear_screen() {
+    if (!isatty(STDOUT_FILENO))
+        return;
+    cout << "\x1b[2J\x1b[H" << flush;
+}
+
+/*********************************************************************
+** Function: draw_round
+** Description: Clears the terminal and pins the round's status line and
+**   board to the top of it, leaving the rest of the screen to scroll
+**   underneath. The board wraps at the terminal's width; a board too
+**   tall to leave room for messages is not pinned.
+** Parameters: Screen *screen - the screen.
+**             const Puzzle &puzzle - the round's freshly censured board.
+** Pre-Conditions: screen was set up by init_screen, and its round and
+**   rounds are set.
+** Post-Conditions: The board is drawn if screen->drawn is true.
+** Return: N/A
+*********************************************************************/
+void draw_round(Screen *screen, const Puzzle &puzzle) {
+    if (!screen->tty)
+        return;
+    int lines = (puzzle.board.length() + screen->width - 1) / screen->width;
+    screen->rows = BOARD_ROW + lines;
+    screen->drawn = screen->rows + 4 < screen->height;
+    screen->out = "\x1b[r\x1b[2J";
+    if (screen->drawn) {
+        for (int l = 0; l < lines; ++l) {
+            cursor_to(&screen->out, BOARD_ROW + l, 1);
+            screen->out.append(puzzle.board, l * screen->width, screen->width);
+        }
+        // Messages scroll in the region below the board.
+        screen->out += "\x1b[" + ::to_string(screen->rows + 1) + 'r';
+        cursor_to(&screen->out, screen->rows + 1, 1);
+    }
+    else screen->out += "\x1b[H";
+    send_screen(screen);
+}
+
+/*********************************************************************
+** Function: show_status
+** Description: Queues a rewrite of the status line with the round and
+**   the current player's round score, cut to the terminal's width.
+** Parameters: Screen *screen - the screen.
+**             const Player &p - the player whose turn it is.
+** Pre-Conditions: draw_round has been called for this round.
+** Post-Conditions: The status line is queued if the board is pinned.
+** Return: N/A
+*********************************************************************/
+void show_status(Screen *screen, const Player &p) {
+    if (!screen->drawn)
+        return;
+    string status = "Round " + ::to_string(screen->round) + " of " + ::to_string(screen->rounds) + "   Player "
+                    + ::to_string(p.number) + "   Score: " + ::to_string(p.round_score);
+    cursor_to(&screen->out, STATUS_ROW, 1);
+    screen->out.append(status, 0, screen->width - 1);
+    screen->out += "\x1b[K";
+}
+
+/*********************************************************************
+** Function: reveal_cells
+** Description: Queues the board cells of a letter that decode_phrase
+**   just revealed. The letter's positions come straight from the
+**   puzzle, so no other cell is compared or resent, and neighbouring
+**   cells share one cursor move.
+** Parameters: Screen *screen - the screen.
+**             const Puzzle &puzzle - the puzzle, after the reveal.
+**             char letter - the lowercase letter revealed.
+** Pre-Conditions: draw_round has been called for this round.
+** Post-Conditions: The cells are queued if the board is pinned.
+** Return: N/A
+*********************************************************************/
+void reveal_cells(Screen *screen, const Puzzle &puzzle, char letter) {
+    if (!screen->drawn)
+        return;
+    int first = puzzle.start[letter - 'a'], last = puzzle.start[letter - 'a' + 1];
+    for (int i = first; i < last; ++i) {
+        int pos = puzzle.positions[i];
+        if (i == first || pos != puzzle.positions[i - 1] + 1 || pos % screen->width == 0)
+            cursor_to(&screen->out, BOARD_ROW + pos / screen->width, 1 + pos % screen->width);
+        screen->out += puzzle.board[pos];
+    }
+}
+
+/*********************************************************************
+** Function: cursor_to
+** Description: Appends the escape sequence that moves the cursor.
+** Parameters: string *out - the output being built.
+**             int row - the row, counted from 1.
+**             int col - the column, counted from 1.
+** Pre-Conditions: N/A
+** Post-Conditions: The sequence is at the end of out.
+** Return: N/A
+*********************************************************************/
+void cursor_to(string *out, int row, int col) {
+    *out += "\x1b[" + ::to_string(row) + ';' + ::to_string(col) + 'H';
+}
+
+/*********************************************************************
+** Function: flush_screen
+** Description: Sends every queued change to the terminal in one write,
+**   saving and restoring the cursor around it so that the prompt stays
+**   where it was in the scrolling region.
+** Parameters: Screen *screen - the screen.
+** Pre-Conditions: N/A
+** Post-Conditions: Nothing is queued.
+** Return: N/A
+*********************************************************************/
+void flush_screen(Screen *screen) {
+    if (screen->out.empty())
+        return;
+    screen->out.insert(0, "\x1b" "7");
+    screen->out += "\x1b" "8";
+    send_screen(screen);
+}
+
+/*********************************************************************
+** Function: send_screen
+** Description: Writes everything queued on a screen to the terminal
+**   with a single write, after any pending console output.
+** Parameters: Screen *screen - the screen.
+** Pre-Conditions: N/A
+** Post-Conditions: Nothing is queued.
+** Return: N/A
+*********************************************************************/
+void send_screen(Screen *screen) {
+    cout.flush();
+    for (size_t done = 0; done < screen->out.size(); ) {
+        ssize_t n = write(STDOUT_FILENO, screen->out.data() + done, screen->out.size() - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    screen->out.clear();
+}
+
+/*********************************************************************
+** Function: close_screen
+** Description: Releases the pinned region of the screen at the end of a
+**   game so that later output scrolls normally.
+** Parameters: Screen *screen - the screen.
+** Pre-Conditions: N/A
+** Post-Conditions: The terminal scrolls the whole screen again.
+** Return: N/A
+*********************************************************************/
+void close_screen(Screen *screen) {
+    if (screen->drawn) {
+        cout << "\x1b" "7\x1b[r\x1b" "8" << flush;
+        screen->drawn = false;
     }
 }
 
@@ -295,45 +1128,122 @@ int censure_phrase(string &s) {
     return letters;
 }
 
+/*********************************************************************
+** Function: prepare_puzzle
+** Description: Sets up a secret phrase for play: censures the board and
+**   indexes the positions of every letter with index_puzzle.
+** Parameters: const string &answer - the secret phrase.
+**             Puzzle *puzzle - the puzzle to set up. Its storage is
+**               reused from round to round.
+** Pre-Conditions: answer is a valid phrase.
+** Post-Conditions: puzzle holds answer, a fully censured board, the
+**   positions of each letter, and the number of hidden letters.
+** Return: N/A
+*********************************************************************/
+void prepare_puzzle(const string &answer, Puzzle *puzzle) {
+    puzzle->answer = answer;
+    puzzle->board = answer;
+    censure_phrase(puzzle->board);
+    index_puzzle(puzzle);
+}
+
+/*********************************************************************
+** Function: store_puzzle
+** Description: Sets up a phrase from a phrase store for play, taking
+**   the board from the store's pre-censured copy.
+** Parameters: const PhraseStore *store - the phrase store.
+**             size_t phrase - which phrase of the store to use.
+**             Puzzle *puzzle - the puzzle to set up. Its storage is
+**               reused from round to round.
+** Pre-Conditions: phrase is less than phrase_count(store).
+** Post-Conditions: Same as prepare_puzzle.
+** Return: N/A
+*********************************************************************/
+void store_puzzle(const PhraseStore *store, size_t phrase, Puzzle *puzzle) {
+    size_t first = store->offsets[phrase], length = store->offsets[phrase + 1] - first;
+    puzzle->answer.assign(store->text, first, length);
+    puzzle->board.assign(store->boards, first, length);
+    index_puzzle(puzzle);
+}
+
+/*********************************************************************
+** Function: index_puzzle
+** Description: Groups the positions of every letter of the answer by
+**   letter, in a single counting pass over the phrase, and counts the
+**   hidden letters.
+** Parameters: Puzzle *puzzle - the puzzle, whose answer and fully
+**               censured board are already set.
+** Pre-Conditions: puzzle->board is the censured puzzle->answer.
+** Post-Conditions: puzzle's positions, start, and hidden are set.
+** Return: N/A
+*********************************************************************/
+void index_puzzle(Puzzle *puzzle) {
+    const string &answer = puzzle->answer;
+    int next[LETTERS_IN_ALPHABET] = {};
+    for (size_t i = 0; i < answer.length(); ++i)
+        if (is_alphabetic(answer[i]))
+            ++next[(answer[i] | 32) - 'a'];
+    puzzle->start[0] = 0;
+    for (int l = 0; l < LETTERS_IN_ALPHABET; ++l) {
+        puzzle->start[l + 1] = puzzle->start[l] + next[l];
+        next[l] = puzzle->start[l];
+    }
+    puzzle->hidden = puzzle->start[LETTERS_IN_ALPHABET];
+    puzzle->positions.resize(puzzle->hidden);
+    for (size_t i = 0; i < answer.length(); ++i)
+        if (is_alphabetic(answer[i]))
+            puzzle->positions[next[(answer[i] | 32) - 'a']++] = i;
+}
+
 /*********************************************************************
 ** Function: take_turn
 ** Description: Conducts one turn for the current player.
 ** Parameters: Player &p - the player whose turn it is.
-**             string &board - the current state of the board.
-**             const string &answer - the secret phrase being guessed.
+**             Puzzle &puzzle - the secret phrase and the current state
+**               of the board.
 **             int *alphabet - a pointer to an integer array keeping
 **               track of which letters have been guessed already.
 **             int &c_guessed - the number of consonants that have
 **               already been guessed.
 **             int &v_guessed - the number of vowels that have already
 **               been bought.
-** Pre-Conditions: N/A
+**             Screen *screen - the terminal showing the round.
+** Pre-Conditions: draw_round has shown this round on screen.
 ** Post-Conditions: The board state, player score, and letters guessed
-**   have all been updated
+**   have all been updated, and the screen shows them.
 ** Return: A boolean variable indicating whether or not the player
 **   correctly guessed the phrase during their turn.
 *********************************************************************/
-bool take_turn(Player &p, string &board, const string &answer, int *alphabet, int &c_guessed, int &v_guessed) {
+bool take_turn(Player &p, Puzzle &puzzle, int *alphabet, int &c_guessed, int &v_guessed, Screen *screen) {
     bool solved = false, end_turn = false;
     int choice;
     cout << "Player " << p.number << ':';
     while (!end_turn) {
-        cout << endl << board << "\n\n";
+        if (screen->drawn) {
+            cout << '\n';
+            show_status(screen, p);
+            flush_screen(screen);
+        }
+        else cout << '\n' << puzzle.board << "\n\n";
         choice = get_integer("Do you want to spin the wheel(1), solve the puzzle(2), or buy a vowel(3)? ", 3);
         if (choice == 1)
-            end_turn = spin_wheel(p, board, answer, alphabet, c_guessed);
+            end_turn = spin_wheel(p, puzzle, alphabet, c_guessed, screen);
         else if (choice == 2) {
-            solved = solve_puzzle(answer);
+            solved = solve_puzzle(puzzle.answer);
+            log_solve(solved);
             end_turn = true;
         }
-        else buy_vowel(p, board, answer, alphabet, v_guessed);
+        else buy_vowel(p, puzzle, alphabet, v_guessed, screen);
 
-        if (case_insensitive_compare(answer, board)) {
+        if (!puzzle.hidden) {
             end_turn = true;
             solved = true;
-            cout << endl << board << "\n\n";
+            if (!screen->drawn)
+                cout << '\n' << puzzle.board << "\n\n";
         }
     }
+    show_status(screen, p);
+    flush_screen(screen);
     return solved;
 }
 
@@ -343,21 +1253,22 @@ bool take_turn(Player &p, string &board, const string &answer, int *alphabet, in
 **   roll a 0 or 21, guess a consonant. It also updates the player's
 **   score and the board.
 ** Parameters: Player &p - the player spinning the wheel.
-**             string &board - the current state of the board.
-**             const string &answer - the secret phrase being guessed.
+**             Puzzle &puzzle - the secret phrase and the current state
+**               of the board.
 **             int *alphabet - a pointer to an integer array keeping
 **               track of which letters have been guessed already.
 **             int &c_guessed - the number of consonants that have
 **               already been guessed.
-** Pre-Conditions: board is a censured version of answer, based on the
-**   censure_phrase function, alphabet is an integer array of length
-**   LETTERS_IN_ALPHABET
+**             Screen *screen - the terminal showing the round.
+** Pre-Conditions: puzzle was set up by prepare_puzzle, alphabet is an
+**   integer array of length LETTERS_IN_ALPHABET
 ** Post-Conditions: p.round_score has been updated based on the outcome
 **   of the wheel spin and the guessed consonant, and the board has been
-**   updated to reveal any correctly guessed consonants.
+**   updated to reveal any correctly guessed consonants, with the
+**   revealed cells queued on screen.
 ** Return: True if the player's turn has ended, false otherwise.
 *********************************************************************/
-bool spin_wheel(Player &p, string &board, const string &answer, int *alphabet, int &c_guessed) {
+bool spin_wheel(Player &p, Puzzle &puzzle, int *alphabet, int &c_guessed, Screen *screen) {
     if (c_guessed >= LETTERS_IN_ALPHABET - NUM_VOWELS) {
 		cout << "\nAll of the consonants have already been guessed.\n";
 		return false;
@@ -369,7 +1280,9 @@ bool spin_wheel(Player &p, string &board, const string &answer, int *alphabet, i
 
     ++c_guessed;
     char consonant = get_letter(alphabet, false);
-    int num_in_phrase = decode_phrase(board, answer, consonant);
+    int num_in_phrase = decode_phrase(puzzle, consonant);
+    reveal_cells(screen, puzzle, consonant);
+    log_letter(consonant, num_in_phrase);
 
     p.round_score += num_in_phrase * spin;
     print_guess_result(p, num_in_phrase, consonant);
@@ -387,104 +1300,688 @@ bool spin_wheel(Player &p, string &board, const string &answer, int *alphabet, i
 **   turn.
 ** Parameters: Player &p - the playing spinning the wheel.
 **             int &spin - the variable that will hold the result.
-** Pre-Conditions: N/A
-** Post-Conditions: If the player spun a 0, p.round_score is set to 0.
-**   spin holds the result of the random spin.
+** Pre-Conditions: The wheel has been set up.
+** Post-Conditions: If the player spun bankrupt, p.round_score is set to
+**   0. spin holds the points per letter of the wedge spun.
 ** Return: True if the player lost their turn, false otherwise.
 *********************************************************************/
 bool random_spin(Player &p, int &spin) {
-    spin = rand() % 22;
-	cout << "\nYou spun a(n) " << spin << "!\n";
-	switch (spin) {
-        case 0:  p.round_score = 0;
-                 cout << "You lose all of your points. ";
-        case 21: cout << "Your turn is over.\n\n";
-                 return true;
+    int wedge = spin_wedge(&wheel, &wheel_rng);
+    spin = wheel.value[wedge];
+    log_spin(wheel.kind[wedge], spin);
+	switch (wheel.kind[wedge]) {
+        case WEDGE_POINTS:    cout << "\nYou spun a(n) " << spin << "!\n";
+                              return false;
+        case WEDGE_BANKRUPT:  cout << "\nYou spun Bankrupt!\n";
+                              p.round_score = 0;
+                              cout << "You lose all of your points. ";
+                              break;
+        default:              cout << "\nYou spun Lose a Turn!\n";
 	}
-	return false;
+    cout << "Your turn is over.\n\n";
+	return true;
 }
 
 /*********************************************************************
-** Function: solve_puzzle
-** Description: Prompts the user to input a puzzle solution and checks
-**   whether the solution was correct.
-** Parameters: const string &answer - the correct solution.
-** Pre-Conditions: N/A
-** Post-Conditions: N/A
-** Return: A boolean value indicating whether or not the puzzle was
-**   correctly solved.
+** Function: default_wheel
+** Description: Sets up the standard wheel: WHEEL_WEDGES equally likely
+**   wedges, where wedge BANKRUPT is bankrupt, wedge LOSE_TURN loses a
+**   turn, and every other wedge is worth its own number in points.
+** Parameters: Wheel *w - the wheel to set up.
+** Pre-Conditions: w points to an empty Wheel.
+** Post-Conditions: w is ready to spin.
+** Return: N/A
 *********************************************************************/
-bool solve_puzzle(const string &answer) {
-    string s;
-    bool correct;
-
-    cout << "\nEnter the phrase: ";
-    getline(cin, s);
-
-    correct = case_insensitive_compare(answer, s);
-    if (correct) {
-        cout << "Correct!\n";
-    }
-    else cout << "That is incorrect.\n\n";
-
-    return correct;
+void default_wheel(Wheel *w) {
+    for (int i = 0; i < WHEEL_WEDGES; ++i)
+        add_wedge(w, i == BANKRUPT ? WEDGE_BANKRUPT : (i == LOSE_TURN ? WEDGE_LOSE_TURN : WEDGE_POINTS), i);
+    finish_wheel(w, vector<double>(WHEEL_WEDGES, 1.0));
 }
 
 /*********************************************************************
-** Function: case_insensitive_compare
-** Description: Compares two equal length strings to see if they are
-**   equal, without case sensitivity.
-** Parameters: const string &s1 - the first string.
-               const string &s2 - the second string,
-** Pre-Conditions: The strings are of equal length.
-** Post-Conditions: N/A
-** Return: True if the strings are equal (ignoring uppercase vs lower-
-**   case discrepancies), false otherwise.
+** Function: load_wheel
+** Description: Reads a wheel layout from a file. Each line is
+**   "wedge <points> <weight>", "bankrupt <weight>", or "lose-turn
+**   <weight>", and the chance of landing on a wedge is its weight over
+**   the total weight. Blank lines and lines starting with '#' are
+**   ignored.
+** Parameters: const char *path - the file to read.
+**             Wheel *w - the wheel to set up.
+** Pre-Conditions: w points to an empty Wheel.
+** Post-Conditions: w is ready to spin if the file was valid.
+** Return: True if the file was read without errors and has a points
+**   wedge with a positive weight, false otherwise.
 *********************************************************************/
-bool case_insensitive_compare(const string &s1, const string &s2) {
-    for (int i = 0; i < s1.length(); ++i) {
-        if (s1[i] != s2[i]) {
-            if (is_alphabetic(s1[i]) && is_alphabetic(s2[i]))
-                if (s1[i] + 32 == s2[i] || s1[i] - 32 == s2[i])
-                    continue;
-            return false;
+bool load_wheel(const char *path, Wheel *w) {
+    ifstream in(path);
+    if (!in)
+        return false;
+    string line, word;
+    vector<double> weights;
+    double weight, points_total = 0;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        if (!(fields >> word) || word[0] == '#')
+            continue;
+        int points = 0;
+        if (word == "wedge") {
+            if (!(fields >> points) || points < 0)
+                return false;
+            add_wedge(w, WEDGE_POINTS, points);
         }
+        else if (word == "bankrupt")
+            add_wedge(w, WEDGE_BANKRUPT, 0);
+        else if (word == "lose-turn")
+            add_wedge(w, WEDGE_LOSE_TURN, 0);
+        else return false;
+        if (!(fields >> weight) || weight < 0)
+            return false;
+        weights.push_back(weight);
+        if (word == "wedge")
+            points_total += weight;
     }
+    if (points_total <= 0)
+        return false;
+    finish_wheel(w, weights);
     return true;
 }
 
 /*********************************************************************
-** Function: buy_vowel
-** Description: Handles vowel buying, including ensuring the player can
-**   afford it and that not all vowels have already been bought.
-** Parameters: Player &p - the player attempting to buy a vowel.
-**             string &board - the current state of the board.
-**             const string &answer - the secret phrase being guessed.
-**             int *alphabet - a pointer to an integer array keeping
-**               track of which letters have been guessed already.
-**             int &v_guessed - the number of vowels that have already
-**               been bought.
-** Pre-Conditions: board is a censured version of answer, based on the
-**   censure_phrase function, alphabet is an integer array of length
-**   LETTERS_IN_ALPHABET
-** Post-Conditions: 10 points have been deducted from p.round_score,
-**   and the board is updated to reveal any correctly guessed vowels.
+** Function: add_wedge
+** Description: Adds a wedge to a wheel that is being set up.
+** Parameters: Wheel *w - the wheel.
+**             int kind - WEDGE_POINTS, WEDGE_BANKRUPT, or WEDGE_LOSE_TURN.
+**             int value - the wedge's points per letter.
+** Pre-Conditions: finish_wheel has not been called on w yet.
+** Post-Conditions: The wedge is the last one of w.
 ** Return: N/A
 *********************************************************************/
-void buy_vowel(Player &p, string &board, const string &answer, int *alphabet, int &v_guessed) {
-    if (p.round_score < 10) {
-        cout << "\nYou don't have enough points to buy a vowel!\n";
-        return;
-    }
-	if (v_guessed >= NUM_VOWELS) {
-		cout << "\nAll of the vowels have already been bought.\n";
-		return;
+void add_wedge(Wheel *w, int kind, int value) {
+    w->kind.push_back(kind);
+    w->value.push_back(value);
+}
+
+/*********************************************************************
+** Function: finish_wheel
+** Description: Builds the alias table of a wheel from its wedge weights.
+** Parameters: Wheel *w - the wheel, with all of its wedges added.
+**             const vector<double> &weights - one non-negative weight
+**               per wedge, with a positive total.
+** Pre-Conditions: weights has one entry per wedge of w.
+** Post-Conditions: w is ready to spin.
+** Return: N/A
+*********************************************************************/
+void finish_wheel(Wheel *w, const vector<double> &weights) {
+    int n = weights.size();
+    double total = 0;
+    for (int i = 0; i < n; ++i)
+        total += weights[i];
+    vector<double> p(n);
+    for (int i = 0; i < n; ++i)
+        p[i] = weights[i] / total;
+    w->threshold.resize(n);
+    w->alias.resize(n);
+    build_alias_table(&p[0], n, &w->threshold[0], &w->alias[0]);
+}
+
+/*********************************************************************
+** Function: spin_wedge
+** Description: Spins the wheel.
+** Parameters: const Wheel *w - the wheel.
+**             RandomStream *rng - the stream to draw from.
+** Pre-Conditions: w is ready to spin.
+** Post-Conditions: The stream has advanced by one value.
+** Return: The index of the wedge landed on.
+*********************************************************************/
+int spin_wedge(const Wheel *w, RandomStream *rng) {
+    return sample_alias(rng, w->value.size(), &w->threshold[0], &w->alias[0]);
+}
+
+/*********************************************************************
+** Function: open_log_file
+** Description: Creates (or empties) an event log and writes its header.
+** Parameters: const char *path - the log file.
+**             LogFile *log - the log to set up.
+** Pre-Conditions: N/A
+** Post-Conditions: log is ready for flush_events.
+** Return: True if the file was created, false otherwise.
+*********************************************************************/
+bool open_log_file(const char *path, LogFile *log) {
+    log->file = fopen(path, "wb");
+    if (!log->file)
+        return false;
+    LogHeader header = {LOG_MAGIC, LOG_VERSION};
+    fwrite(&header, sizeof(header), 1, log->file);
+    return true;
+}
+
+/*********************************************************************
+** Function: close_log_file
+** Description: Closes an event log, if open.
+** Parameters: LogFile *log - the event log.
+** Pre-Conditions: Every thread has flushed its events.
+** Post-Conditions: The file has been flushed and closed.
+** Return: N/A
+*********************************************************************/
+void close_log_file(LogFile *log) {
+    if (log->file)
+        fclose(log->file);
+    log->file = 0;
+}
+
+/*********************************************************************
+** Function: flush_events
+** Description: Appends a thread's buffered events to the log file, as
+**   one write under the file's lock.
+** Parameters: EventLog *events - the thread's buffered events.
+** Pre-Conditions: events holds whole rounds.
+** Post-Conditions: The buffer is empty.
+** Return: N/A
+*********************************************************************/
+void flush_events(EventLog *events) {
+    if (events->bytes.empty())
+        return;
+    {
+        lock_guard<mutex> guard(events->out->lock);
+        fwrite(&events->bytes[0], 1, events->bytes.size(), events->out->file);
+    }
+    events->bytes.clear();
+}
+
+/*********************************************************************
+** Function: put_varint
+** Description: Appends a value to a thread's events as a varint, so
+**   that values under 128 (nearly all of them) take a single byte.
+** Parameters: EventLog *events - the thread's buffered events.
+**             uint64_t value - the value.
+** Pre-Conditions: N/A
+** Post-Conditions: The value's bytes are at the end of the buffer.
+** Return: N/A
+*********************************************************************/
+void put_varint(EventLog *events, uint64_t value) {
+    while (value >= 0x80) {
+        events->bytes.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    events->bytes.push_back((unsigned char)value);
+}
+
+/*********************************************************************
+** Function: log_round
+** Description: Records the start of a round, writing out this thread's
+**   earlier rounds first once enough of them have been buffered.
+** Parameters: const string &answer - the round's secret phrase.
+**             int players - how many players take turns.
+**             int vowel_price - what a vowel costs.
+** Pre-Conditions: N/A
+** Post-Conditions: The event is buffered if this thread is logging.
+** Return: N/A
+*********************************************************************/
+void log_round(const string &answer, int players, int vowel_price) {
+    if (!game_log)
+        return;
+    if (game_log->bytes.size() >= LOG_FLUSH_BYTES)
+        flush_events(game_log);
+    game_log->bytes.push_back(EVENT_ROUND);
+    put_varint(game_log, players);
+    put_varint(game_log, vowel_price);
+    put_varint(game_log, answer.length());
+    game_log->bytes.insert(game_log->bytes.end(), answer.begin(), answer.end());
+}
+
+/*********************************************************************
+** Function: log_turn
+** Description: Records the start of a player's turn.
+** Parameters: int player - the player, counted from 0.
+** Pre-Conditions: log_round has been called for this round.
+** Post-Conditions: The event is buffered if this thread is logging.
+** Return: N/A
+*********************************************************************/
+void log_turn(int player) {
+    if (!game_log)
+        return;
+    game_log->bytes.push_back(EVENT_TURN);
+    put_varint(game_log, player);
+}
+
+/*********************************************************************
+** Function: log_spin
+** Description: Records a spin of the wheel.
+** Parameters: int kind - the kind of wedge landed on.
+**             int value - the wedge's points per letter.
+** Pre-Conditions: log_turn has been called for this turn.
+** Post-Conditions: The event is buffered if this thread is logging.
+** Return: N/A
+*********************************************************************/
+void log_spin(int kind, int value) {
+    if (!game_log)
+        return;
+    game_log->bytes.push_back(EVENT_SPIN);
+    put_varint(game_log, kind);
+    put_varint(game_log, value);
+}
+
+/*********************************************************************
+** Function: log_letter
+** Description: Records a consonant called or a vowel bought.
+** Parameters: char letter - the lowercase letter.
+**             int found - how many of it were revealed.
+** Pre-Conditions: log_turn has been called for this turn.
+** Post-Conditions: The event is buffered if this thread is logging.
+** Return: N/A
+*********************************************************************/
+void log_letter(char letter, int found) {
+    if (!game_log)
+        return;
+    game_log->bytes.push_back(is_vowel(letter - 'a') ? EVENT_VOWEL : EVENT_CONSONANT);
+    game_log->bytes.push_back(letter);
+    put_varint(game_log, found);
+}
+
+/*********************************************************************
+** Function: log_solve
+** Description: Records an attempt to solve the puzzle.
+** Parameters: bool correct - whether the attempt was right.
+** Pre-Conditions: log_turn has been called for this turn.
+** Post-Conditions: The event is buffered if this thread is logging.
+** Return: N/A
+*********************************************************************/
+void log_solve(bool correct) {
+    if (!game_log)
+        return;
+    game_log->bytes.push_back(EVENT_SOLVE);
+    game_log->bytes.push_back(correct);
+}
+
+/*********************************************************************
+** Function: open_log_view
+** Description: Memory-maps an event log for reading.
+** Parameters: const char *path - the log file.
+**             LogView *view - the view to set up.
+** Pre-Conditions: N/A
+** Post-Conditions: view spans the log's events.
+** Return: True if the log was mapped and has a valid header, false
+**   otherwise.
+*********************************************************************/
+bool open_log_view(const char *path, LogView *view) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0 || info.st_size < (off_t)sizeof(LogHeader)) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    void *map = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    view->map = map;
+    view->map_size = info.st_size;
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+    const LogHeader *header = (const LogHeader*)map;
+    if (header->magic != LOG_MAGIC || header->version != LOG_VERSION) {
+        close_log_view(view);
+        return false;
+    }
+    view->events = (const unsigned char*)(header + 1);
+    view->end = (const unsigned char*)map + info.st_size;
+    return true;
+}
+
+/*********************************************************************
+** Function: close_log_view
+** Description: Unmaps an event log.
+** Parameters: LogView *view - the mapped event log.
+** Pre-Conditions: N/A
+** Post-Conditions: view no longer refers to any memory.
+** Return: N/A
+*********************************************************************/
+void close_log_view(LogView *view) {
+    if (view->map)
+        munmap(view->map, view->map_size);
+    view->map = 0;
+    view->events = view->end = 0;
+}
+
+/*********************************************************************
+** Function: get_varint
+** Description: Reads one varint written by put_varint.
+** Parameters: const unsigned char **p - the read position, advanced
+**               past the varint.
+**             const unsigned char *end - the end of the log.
+**             uint64_t *value - receives the value.
+** Pre-Conditions: *p is at most end.
+** Post-Conditions: N/A
+** Return: True if a whole varint was read, false otherwise.
+*********************************************************************/
+bool get_varint(const unsigned char **p, const unsigned char *end, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/*********************************************************************
+** Function: next_event
+** Description: Decodes the event at the read position of a log.
+** Parameters: const unsigned char **p - the read position, advanced
+**               past the event.
+**             const unsigned char *end - the end of the log.
+**             LogEvent *e - receives the event.
+** Pre-Conditions: *p is the start of an event and less than end.
+** Post-Conditions: N/A
+** Return: True if a whole, well-formed event was read, false if the log
+**   is truncated or damaged there.
+*********************************************************************/
+bool next_event(const unsigned char **p, const unsigned char *end, LogEvent *e) {
+    e->kind = *(*p)++;
+    switch (e->kind) {
+        case EVENT_ROUND:
+            if (!get_varint(p, end, &e->a) || !get_varint(p, end, &e->b) || !get_varint(p, end, &e->c)
+                || !e->a || e->c > (uint64_t)(end - *p))
+                return false;
+            e->text = (const char*)*p;
+            *p += e->c;
+            return true;
+        case EVENT_TURN:
+            return get_varint(p, end, &e->a);
+        case EVENT_SPIN:
+            return get_varint(p, end, &e->a) && get_varint(p, end, &e->b) && e->a <= WEDGE_LOSE_TURN;
+        case EVENT_CONSONANT:
+        case EVENT_VOWEL:
+            if (*p == end)
+                return false;
+            e->a = *(*p)++;
+            return e->a >= 'a' && e->a <= 'z' && is_vowel(e->a - 'a') == (e->kind == EVENT_VOWEL)
+                   && get_varint(p, end, &e->b);
+        case EVENT_SOLVE:
+            if (*p == end)
+                return false;
+            e->a = *(*p)++;
+            return e->a <= 1;
+    }
+    return false;
+}
+
+/*********************************************************************
+** Function: score_event
+** Description: Applies one logged event to the scores of the round
+**   being read back, by the same rules as take_turn and bot_turn.
+** Parameters: const LogEvent &e - the event.
+**             LogRound *round - the round's scores and current turn.
+** Pre-Conditions: e is not an EVENT_ROUND.
+** Post-Conditions: round reflects the event.
+** Return: True if the event fits the round, false if it names a player
+**   who is not in it or comes before the round's first turn.
+*********************************************************************/
+bool score_event(const LogEvent &e, LogRound *round) {
+    if (e.kind == EVENT_TURN) {
+        if (e.a >= round->score.size())
+            return false;
+        round->player = e.a;
+        return true;
+    }
+    if (round->player < 0)
+        return false;
+    int &score = round->score[round->player];
+    if (e.kind == EVENT_SPIN) {
+        round->spin = e.b;
+        if (e.a == WEDGE_BANKRUPT)
+            score = 0;
+    }
+    else if (e.kind == EVENT_CONSONANT)
+        score += e.b * round->spin;
+    else if (e.kind == EVENT_VOWEL)
+        score -= round->vowel_price;
+    return true;
+}
+
+/*********************************************************************
+** Function: replay_log
+** Description: Plays an event log back round by round, with no input
+**   and no random draws: every spin, letter, and solve attempt is shown
+**   as it was recorded, the board is rebuilt from the logged phrase, and
+**   each round's winner banks their round score. The final standings
+**   cover every round in the log.
+** Parameters: const LogView *view - the mapped event log.
+** Pre-Conditions: view was opened by open_log_view.
+** Post-Conditions: The play-by-play has been output to the console.
+** Return: True if the whole log was read back and every revealed count
+**   matched its phrase, false if the log is damaged.
+*********************************************************************/
+bool replay_log(const LogView *view) {
+    vector<Player> players;
+    LogRound round;
+    Puzzle puzzle;
+    LogEvent e;
+    int rounds = 0;
+    bool intact = true;
+    for (const unsigned char *p = view->events; ; ) {
+        bool more = p < view->end;
+        if (more && !(more = intact = next_event(&p, view->end, &e)))
+            break;
+        if (rounds && (!more || e.kind == EVENT_ROUND) && round.player >= 0) {
+            Player &winner = players[round.player];
+            winner.round_score = round.score[round.player];
+            winner.total_score += winner.round_score;
+            cout << "Player " << winner.number << " won Round " << rounds << ", accumulating "
+                 << winner.round_score << " points.\n";
+        }
+        if (!more)
+            break;
+
+        if (e.kind == EVENT_ROUND) {
+            round.score.assign(e.a, 0);
+            round.vowel_price = e.b;
+            round.player = -1;
+            while (players.size() < e.a) {
+                players.push_back(Player());
+                players.back().number = players.size();
+            }
+            prepare_puzzle(string(e.text, e.c), &puzzle);
+            cout << "\nRound " << ++rounds << ":\n" << puzzle.board << endl;
+            continue;
+        }
+        if (!rounds || !score_event(e, &round)) {
+            intact = false;
+            break;
+        }
+        int number = players[round.player].number;
+        if (e.kind == EVENT_TURN)
+            cout << "Player " << number << ":\n";
+        else if (e.kind == EVENT_SPIN) {
+            if (e.a == WEDGE_POINTS)
+                cout << "   Spun " << e.b << ".\n";
+            else cout << (e.a == WEDGE_BANKRUPT ? "   Spun Bankrupt.\n" : "   Spun Lose a Turn.\n");
+        }
+        else if (e.kind == EVENT_SOLVE)
+            cout << (e.a ? "   Solved the puzzle: " + puzzle.answer + "\n" : string("   Missed the solution.\n"));
+        else {
+            if ((uint64_t)decode_phrase(puzzle, e.a) != e.b) {
+                intact = false;
+                break;
+            }
+            cout << (e.kind == EVENT_VOWEL ? "   Bought " : "   Called ") << (char)e.a << ", " << e.b
+                 << " found. Score: " << round.score[round.player] << "   " << puzzle.board << endl;
+        }
+    }
+    if (!players.empty()) {
+        Standings standings;
+        init_standings(&standings, players.size(), &players[0]);
+        declare_winner(&standings);
+    }
+    return intact;
+}
+
+/*********************************************************************
+** Function: print_log_stats
+** Description: Summarizes an event log in one pass over the mapped
+**   file, without replaying any puzzle: how long rounds ran, how spins
+**   landed, how often each letter was called and paid off, how solve
+**   attempts went, and what winning a round was worth.
+** Parameters: const LogView *view - the mapped event log.
+** Pre-Conditions: view was opened by open_log_view.
+** Post-Conditions: The summary has been output to the console.
+** Return: True if the whole log was read, false if it is damaged (the
+**   summary then covers the rounds before the damage).
+*********************************************************************/
+bool print_log_stats(const LogView *view) {
+    long long rounds = 0, turns = 0, spins[WEDGE_LOSE_TURN + 1] = {}, spin_points = 0, solves = 0, correct = 0;
+    long long calls[LETTERS_IN_ALPHABET] = {}, hits[LETTERS_IN_ALPHABET] = {}, found[LETTERS_IN_ALPHABET] = {};
+    long long winnings = 0;
+    LogRound round;
+    LogEvent e;
+    bool intact = true;
+    for (const unsigned char *p = view->events; ; ) {
+        bool more = p < view->end;
+        if (more && !(more = intact = next_event(&p, view->end, &e)))
+            break;
+        if (rounds && (!more || e.kind == EVENT_ROUND) && round.player >= 0)
+            winnings += round.score[round.player];
+        if (!more)
+            break;
+
+        if (e.kind == EVENT_ROUND) {
+            ++rounds;
+            round.score.assign(e.a, 0);
+            round.vowel_price = e.b;
+            round.player = -1;
+            continue;
+        }
+        if (!rounds || !score_event(e, &round)) {
+            intact = false;
+            break;
+        }
+        if (e.kind == EVENT_TURN)
+            ++turns;
+        else if (e.kind == EVENT_SPIN) {
+            ++spins[e.a];
+            if (e.a == WEDGE_POINTS)
+                spin_points += e.b;
+        }
+        else if (e.kind == EVENT_SOLVE) {
+            ++solves;
+            correct += e.a;
+        }
+        else {
+            ++calls[e.a - 'a'];
+            hits[e.a - 'a'] += e.b > 0;
+            found[e.a - 'a'] += e.b;
+        }
+    }
+    if (!rounds) {
+        cout << "The log holds no rounds.\n";
+        return intact;
+    }
+
+    long long total_spins = spins[WEDGE_POINTS] + spins[WEDGE_BANKRUPT] + spins[WEDGE_LOSE_TURN];
+    cout << fixed << setprecision(2);
+    cout << "Rounds logged: " << rounds << "\nAverage turns per round: " << (double)turns / rounds
+         << "\nAverage winning score: " << (double)winnings / rounds << "\nSpins: " << total_spins;
+    if (total_spins)
+        cout << " (" << 100.0 * spins[WEDGE_BANKRUPT] / total_spins << "% bankrupt, "
+             << 100.0 * spins[WEDGE_LOSE_TURN] / total_spins << "% lose a turn, "
+             << (spins[WEDGE_POINTS] ? (double)spin_points / spins[WEDGE_POINTS] : 0.0) << " points per scoring spin)";
+    cout << "\nSolve attempts: " << solves;
+    if (solves)
+        cout << " (" << 100.0 * correct / solves << "% correct)";
+    cout << "\n\nLetter  Times called  Hit rate  Avg revealed\n";
+    for (int l = 0; l < LETTERS_IN_ALPHABET; ++l)
+        if (calls[l])
+            cout << "   " << (char)('a' + l) << setw(16) << calls[l] << setw(9) << 100.0 * hits[l] / calls[l] << '%'
+                 << setw(14) << (double)found[l] / calls[l] << '\n';
+    return intact;
+}
+
+/*********************************************************************
+** Function: solve_puzzle
+** Description: Prompts the user to input a puzzle solution and checks
+**   whether the solution was correct.
+** Parameters: const string &answer - the correct solution.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: A boolean value indicating whether or not the puzzle was
+**   correctly solved.
+*********************************************************************/
+bool solve_puzzle(const string &answer) {
+    string s;
+    bool correct;
+
+    cout << "\nEnter the phrase: ";
+    getline(cin, s);
+
+    correct = case_insensitive_compare(answer, s);
+    if (correct) {
+        cout << "Correct!\n";
+    }
+    else cout << "That is incorrect.\n\n";
+
+    return correct;
+}
+
+/*********************************************************************
+** Function: case_insensitive_compare
+** Description: Compares two equal length strings to see if they are
+**   equal, without case sensitivity.
+** Parameters: const string &s1 - the first string.
+               const string &s2 - the second string,
+** Pre-Conditions: The strings are of equal length.
+** Post-Conditions: N/A
+** Return: True if the strings are equal (ignoring uppercase vs lower-
+**   case discrepancies), false otherwise.
+*********************************************************************/
+bool case_insensitive_compare(const string &s1, const string &s2) {
+    for (int i = 0; i < s1.length(); ++i) {
+        if (s1[i] != s2[i]) {
+            if (is_alphabetic(s1[i]) && is_alphabetic(s2[i]))
+                if (s1[i] + 32 == s2[i] || s1[i] - 32 == s2[i])
+                    continue;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*********************************************************************
+** Function: buy_vowel
+** Description: Handles vowel buying, including ensuring the player can
+**   afford it and that not all vowels have already been bought.
+** Parameters: Player &p - the player attempting to buy a vowel.
+**             Puzzle &puzzle - the secret phrase and the current state
+**               of the board.
+**             int *alphabet - a pointer to an integer array keeping
+**               track of which letters have been guessed already.
+**             int &v_guessed - the number of vowels that have already
+**               been bought.
+**             Screen *screen - the terminal showing the round.
+** Pre-Conditions: puzzle was set up by prepare_puzzle, alphabet is an
+**   integer array of length LETTERS_IN_ALPHABET
+** Post-Conditions: VOWEL_PRICE points have been deducted from p.round_score,
+**   and the board is updated to reveal any correctly guessed vowels,
+**   with the revealed cells queued on screen.
+** Return: N/A
+*********************************************************************/
+void buy_vowel(Player &p, Puzzle &puzzle, int *alphabet, int &v_guessed, Screen *screen) {
+    if (p.round_score < VOWEL_PRICE) {
+        cout << "\nYou don't have enough points to buy a vowel!\n";
+        return;
+    }
+	if (v_guessed >= NUM_VOWELS) {
+		cout << "\nAll of the vowels have already been bought.\n";
+		return;
 	}
     cout << endl;
-	p.round_score -= 10;
+	p.round_score -= VOWEL_PRICE;
 	++v_guessed;
     char vowel = get_letter(alphabet, true);
-	int num_in_phrase = decode_phrase(board, answer, vowel);
+	int num_in_phrase = decode_phrase(puzzle, vowel);
+    reveal_cells(screen, puzzle, vowel);
+    log_letter(vowel, num_in_phrase);
     print_guess_result(p, num_in_phrase, vowel);
 }
 
@@ -549,27 +2046,26 @@ bool is_vowel(int pos) {
 
 /*********************************************************************
 ** Function: decode_phrase
-** Description: Searches the phrase for a certain letter, reveals
-**   the locations of any instances, and returns the number found.
-** Parameters: string &board - a string containing the current state
+** Description: Reveals every instance of a letter on the board and
+**   returns the number found. Only the letter's own positions are
+**   visited, so the cost does not depend on the length of the phrase.
+** Parameters: Puzzle &puzzle - the secret phrase and the current state
 **               of the board.
-**             const string &answer - the secret phrase being guessed.
-**             char letter - the letter to search for in answer.
-** Pre-Conditions: board and answer are the same length
+**             char letter - the letter to reveal.
+** Pre-Conditions: puzzle was set up by prepare_puzzle and letter is a
+**   lowercase letter.
 ** Post-Conditions: Any instances of the letter (or its uppercase
-**   version) found in the answer string will be copied into the
-**   corresponding element of the board string.
+**   version) in the answer have been copied onto the board, and the
+**   hidden count no longer includes them.
 ** Return: The non-negative number of instances found.
 *********************************************************************/
-int decode_phrase(string &board, const string &answer, char letter) {
-    int instances = 0;
-    for (int i = 0; i < answer.length(); ++i) {
-        if ((letter == answer[i]) || (letter - 32 == answer[i])) {
-            board[i] = answer[i];
-            ++instances;
-        }
-    }
-    return instances;
+int decode_phrase(Puzzle &puzzle, char letter) {
+    int first = puzzle.start[letter - 'a'], last = puzzle.start[letter - 'a' + 1];
+    if (first < last && puzzle.board[puzzle.positions[first]] == '_')
+        puzzle.hidden -= last - first;
+    for (int i = first; i < last; ++i)
+        puzzle.board[puzzle.positions[i]] = puzzle.answer[puzzle.positions[i]];
+    return last - first;
 }
 
 /*********************************************************************
@@ -615,74 +2111,1709 @@ void reset_guess_history(int *ab, int &c, int &v) {
 /*********************************************************************
 ** Function: declare_winner
 ** Description: Prints the final standings and declares the winner.
-** Parameters: int num_p - an integer from 1-3 containing the number of
-**               of players.
-**             Player *p -  an array of Player objects of length num_p.
-** Pre-Conditions: num_p is an integer from 1-3 and p is a Player
-**   object array of length num_p.
-** Post-Conditions: The final standings have been output to the console
-**   and the winner has been declared.
+** Parameters: const Standings *standings - the players' standings.
+**             ostream &out - where to print them (the console unless
+**               given).
+** Pre-Conditions: standings is up to date.
+** Post-Conditions: The final standings have been output and the winner
+**   has been declared.
 ** Return: N/A
 *********************************************************************/
-void declare_winner(int num_p, Player *p) {
-	int winner = print_standings(num_p, p, true);
+void declare_winner(const Standings *standings, ostream &out) {
+	int winner = print_standings(standings, true, out);
 	if (!winner)
-		cout << "\nIt was a tie!\n";
-	else cout << "\nPlayer " << winner << " is the winner!\n\n";
+		out << "\nIt was a tie!\n";
+	else out << "\nPlayer " << winner << " is the winner!\n\n";
 }
 
 /*********************************************************************
 ** Function: print_standings
-** Description: Sorts the players by total score, prints the standings,
+** Description: Prints the top STANDINGS_SHOWN players of the standings
 **   and returns the number of the winning player.
-** Parameters: int num_p - an integer from 1-3 containing the number of
-**               of players.
-**             Player *p -  an array of Player objects of length num_p.
+** Parameters: const Standings *standings - the players' standings.
 **             bool final_score - whether or not these are the final
 **               standings.
-** Pre-Conditions: num_p is an integer from 1-3 and p is a Player
-**   object array of length num_p.
-** Post-Conditions: The standings have been output to the console.
+**             ostream &out - where to print them (the console unless
+**               given).
+** Pre-Conditions: standings is up to date.
+** Post-Conditions: The standings have been output.
 ** Return: The number of the winning player. If two or more players
 **   share the highest score, 0 is returned.
 *********************************************************************/
-int print_standings(int num_p, Player *p, bool final_score) {
-    Player *standings[num_p];
-    for (int i = 0; i < num_p; ++i)
-        standings[i] = &p[i];
+int print_standings(const Standings *standings, bool final_score, ostream &out) {
+    const vector<int> &order = standings->order;
+    const Player *p = standings->players;
+    int num_p = order.size(), shown = min(num_p, STANDINGS_SHOWN);
 
-    sort_by_total_score(num_p, standings);
+    out << endl << (final_score ? "Final" : "Current") << " Standings:\n";
+    for (int i = 0; i < shown; ++i)
+        out << "   Player " << p[order[i]].number << "   " << p[order[i]].total_score << endl;
+    if (shown < num_p)
+        out << "   ... and " << num_p - shown << " more\n";
 
-    cout << endl << (final_score ? "Final" : "Current") << " Standings:\n";
+    if (num_p > 1 && p[order[0]].total_score == p[order[1]].total_score)
+        return 0;
+    else return p[order[0]].number;
+}
+
+/*********************************************************************
+** Function: init_standings
+** Description: Sets up standings for an array of players.
+** Parameters: Standings *standings - the standings to set up.
+**             int num_p - the number of players.
+**             const Player *p - an array of Player objects of length
+**               num_p, which must outlive the standings.
+** Pre-Conditions: num_p is positive.
+** Post-Conditions: standings orders the players by total score.
+** Return: N/A
+*********************************************************************/
+void init_standings(Standings *standings, int num_p, const Player *p) {
+    standings->players = p;
+    standings->order.resize(num_p);
+    standings->rank.resize(num_p);
     for (int i = 0; i < num_p; ++i)
-        cout << "   Player " << standings[i]->number << "   " << standings[i]->total_score << endl;
+        standings->order[i] = i;
+    sort_standings(standings);
+}
 
-	if (num_p > 1 && standings[0]->total_score == standings[1]->total_score)
-        return 0;
-    else return standings[0]->number;
+/*********************************************************************
+** Function: sort_standings
+** Description: Re-sorts all of the standings at once, which is cheaper
+**   than update_standing when many totals changed together.
+** Parameters: Standings *standings - the standings to sort.
+** Pre-Conditions: standings was set up by init_standings.
+** Post-Conditions: order and rank match the players' current totals.
+** Return: N/A
+*********************************************************************/
+void sort_standings(Standings *standings) {
+    vector<int> &order = standings->order;
+    sort(order.begin(), order.end(), [standings](int a, int b) {
+        return ranks_above(standings, a, b);
+    });
+    for (size_t i = 0; i < order.size(); ++i)
+        standings->rank[order[i]] = i;
+}
+
+/*********************************************************************
+** Function: update_standing
+** Description: Moves one player to their new place after their total
+**   score changed. The place is found by binary search, and only the
+**   players between the old and new places are shifted.
+** Parameters: Standings *standings - the standings.
+**             int player - the index of the player whose total changed.
+** Pre-Conditions: standings was in order before that player's total
+**   changed.
+** Post-Conditions: order and rank match the players' current totals.
+** Return: N/A
+*********************************************************************/
+void update_standing(Standings *standings, int player) {
+    vector<int> &order = standings->order;
+    int num_p = order.size(), from = standings->rank[player], to;
+    if (from > 0 && ranks_above(standings, player, order[from - 1])) {
+        to = upper_bound(order.begin(), order.begin() + from, player, [standings](int a, int b) {
+            return ranks_above(standings, a, b);
+        }) - order.begin();
+        rotate(order.begin() + to, order.begin() + from, order.begin() + from + 1);
+        for (int i = to; i <= from; ++i)
+            standings->rank[order[i]] = i;
+    }
+    else if (from + 1 < num_p && ranks_above(standings, order[from + 1], player)) {
+        to = lower_bound(order.begin() + from + 1, order.end(), player, [standings](int a, int b) {
+            return ranks_above(standings, a, b);
+        }) - order.begin() - 1;
+        rotate(order.begin() + from, order.begin() + from + 1, order.begin() + to + 1);
+        for (int i = from; i <= to; ++i)
+            standings->rank[order[i]] = i;
+    }
+}
+
+/*********************************************************************
+** Function: ranks_above
+** Description: Compares two players by total score, breaking ties in
+**   favor of the earlier player.
+** Parameters: const Standings *standings - the standings.
+**             int a - the index of the first player.
+**             int b - the index of the second player.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if player a places ahead of player b, false otherwise.
+*********************************************************************/
+bool ranks_above(const Standings *standings, int a, int b) {
+    const Player *p = standings->players;
+    return p[a].total_score != p[b].total_score ? p[a].total_score > p[b].total_score : a < b;
+}
+
+/*********************************************************************
+** Function: find_option
+** Description: Searches the command-line arguments for a flag and
+**   returns the argument that immediately follows it.
+** Parameters: int argc - the number of command-line arguments.
+**             char *argv[] - the command-line arguments.
+**             const char *flag - the flag to search for, e.g. "--seed".
+** Pre-Conditions: argv holds argc C-style strings.
+** Post-Conditions: N/A
+** Return: The argument following flag, or a null pointer if the flag
+**   was not passed or has no value after it.
+*********************************************************************/
+const char* find_option(int argc, char *argv[], const char *flag) {
+    for (int i = 1; i < argc - 1; ++i)
+        if (!strcmp(argv[i], flag))
+            return argv[i + 1];
+    return 0;
+}
+
+/*********************************************************************
+** Function: load_phrase_store
+** Description: Loads a phrase file, one phrase per line, into a phrase
+**   store. The file is memory-mapped and split at line boundaries into
+**   one chunk per thread; each thread validates its lines and keeps the
+**   valid ones, and the chunks are then joined in file order.
+** Parameters: const char *path - the phrase file.
+**             int threads - the number of loader threads to use.
+**             PhraseStore *store - where the phrases are stored.
+** Pre-Conditions: store points to an empty PhraseStore.
+** Post-Conditions: store holds every valid phrase of the file, in order.
+**   The number of rejected lines is reported on stderr.
+** Return: True if the file was read and held at least one valid phrase,
+**   false otherwise.
+*********************************************************************/
+bool load_phrase_store(const char *path, int threads, PhraseStore *store) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0 || info.st_size == 0) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void *map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    const char *data = (const char*)map;
+
+    if (threads < 1)
+        threads = 1;
+    vector<const char*> bounds(1, data);
+    for (int t = 1; t < threads; ++t) {
+        const char *cut = max(data + size * t / threads, bounds.back());
+        const char *newline = (const char*)memchr(cut, '\n', data + size - cut);
+        bounds.push_back(newline ? newline + 1 : data + size);
+    }
+    bounds.push_back(data + size);
+
+    vector<PhraseChunk> chunks(threads);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(thread(scan_phrases, bounds[t], bounds[t + 1], &chunks[t]));
+    size_t total = 0, count = 0;
+    long long rejected = 0;
+    for (int t = 0; t < threads; ++t) {
+        workers[t].join();
+        total += chunks[t].text.size();
+        count += chunks[t].ends.size();
+        rejected += chunks[t].rejected;
+    }
+    munmap(map, size);
+
+    store->text.reserve(total);
+    store->boards.reserve(total);
+    store->offsets.reserve(count + 1);
+    store->offsets.push_back(0);
+    for (int t = 0; t < threads; ++t) {
+        size_t base = store->text.size();
+        store->text += chunks[t].text;
+        store->boards += chunks[t].boards;
+        for (size_t i = 0; i < chunks[t].ends.size(); ++i)
+            store->offsets.push_back(base + chunks[t].ends[i]);
+        PhraseChunk().text.swap(chunks[t].text);
+    }
+    if (rejected)
+        cerr << "Skipped " << rejected << " invalid phrase(s) in " << path << endl;
+    return count > 0;
 }
 
 /*********************************************************************
-** Function: sort_by_total_score
-** Description: Sorts the players by total score in descending order.
-** Parameters: int num_p - an integer from 1-3 containing the number of
-**               of players.
-**             Player **standings -  an array of pointers to Player
-**               objects of length num_p to be sorted by total_score.
-** Pre-Conditions: num_p is an integer from 1-3 and standings is an
-**   array of pointers to Player objects of length num_p.
-** Post-Conditions: standings has been sorted by total_score in
-**   descending order.
+** Function: scan_phrases
+** Description: Thread body for load_phrase_store. Splits its chunk of
+**   the file into lines, ignoring carriage returns and empty lines, and
+**   keeps each valid phrase along with its censured board.
+** Parameters: const char *begin - the first character of the chunk.
+**             const char *end - one past the last character.
+**             PhraseChunk *chunk - where the chunk's phrases are stored.
+** Pre-Conditions: The chunk starts at the beginning of a line and no
+**   other thread writes to chunk.
+** Post-Conditions: chunk holds the chunk's valid phrases and the number
+**   of invalid ones.
+** Return: N/A
+*********************************************************************/
+void scan_phrases(const char *begin, const char *end, PhraseChunk *chunk) {
+    while (begin < end) {
+        const char *newline = (const char*)memchr(begin, '\n', end - begin);
+        const char *line_end = (newline ? newline : end);
+        size_t length = line_end - begin;
+        if (length && begin[length - 1] == '\r')
+            --length;
+        if (length) {
+            if (valid_phrase(begin, length)) {
+                chunk->text.append(begin, length);
+                chunk->boards.append(begin, length);
+                for (size_t i = chunk->boards.size() - length; i < chunk->boards.size(); ++i)
+                    if (is_alphabetic(chunk->boards[i]))
+                        chunk->boards[i] = '_';
+                chunk->ends.push_back(chunk->text.size());
+            }
+            else ++chunk->rejected;
+        }
+        begin = line_end + 1;
+    }
+}
+
+/*********************************************************************
+** Function: phrase_count
+** Description: Returns how many phrases a phrase store holds.
+** Parameters: const PhraseStore *store - the phrase store.
+** Pre-Conditions: store was filled by load_phrase_store.
+** Post-Conditions: N/A
+** Return: The number of phrases.
+*********************************************************************/
+size_t phrase_count(const PhraseStore *store) {
+    return store->offsets.size() - 1;
+}
+
+/*********************************************************************
+** Function: store_phrase
+** Description: Copies one phrase out of a phrase store.
+** Parameters: const PhraseStore *store - the phrase store.
+**             size_t phrase - which phrase to copy.
+** Pre-Conditions: phrase is less than phrase_count(store).
+** Post-Conditions: N/A
+** Return: The phrase.
+*********************************************************************/
+string store_phrase(const PhraseStore *store, size_t phrase) {
+    return store->text.substr(store->offsets[phrase], store->offsets[phrase + 1] - store->offsets[phrase]);
+}
+
+/*********************************************************************
+** Function: parse_bots
+** Description: Turns a comma-separated list of strategy names into the
+**   seats of a simulated game.
+** Parameters: const char *list - e.g. "frequency,greedy,random".
+**             vector<const Strategy*> &seats - one entry per seat, in
+**               turn order.
+** Pre-Conditions: N/A
+** Post-Conditions: seats holds the strategy of every listed bot.
+** Return: True if every name matched a strategy and at least one bot was
+**   listed, false otherwise.
+*********************************************************************/
+bool parse_bots(const char *list, vector<const Strategy*> &seats) {
+    stringstream ss(list);
+    string name;
+    while (getline(ss, name, ',')) {
+        int i = 0;
+        while (i < NUM_STRATEGIES && name != STRATEGIES[i].name)
+            ++i;
+        if (i == NUM_STRATEGIES)
+            return false;
+        seats.push_back(&STRATEGIES[i]);
+    }
+    return !seats.empty();
+}
+
+/*********************************************************************
+** Function: run_bot_simulation
+** Description: Splits the requested rounds across worker threads, each
+**   with its own random stream derived from the seed, and merges their
+**   results once they all finish. The candidate index is built first if
+**   any bot needs it.
+** Parameters: long long rounds - the total number of rounds to play.
+**             int threads - the number of worker threads to use.
+**             uint64_t seed - the run's seed.
+**             const PhraseStore &corpus - the phrases to draw from.
+**             const vector<const Strategy*> &seats - the bots, in turn
+**               order.
+**             int vowel_price - what a vowel costs.
+**             LogFile *log_file - the event log to record every round
+**               to, or a null pointer.
+**             BotStats *total - where the combined results are stored.
+** Pre-Conditions: corpus and seats are not empty, and total points to
+**   an empty BotStats object.
+** Post-Conditions: total holds the results of every round played.
+** Return: The wall-clock time the simulation took, in seconds.
+*********************************************************************/
+double run_bot_simulation(long long rounds, int threads, uint64_t seed, const PhraseStore &corpus,
+                          const vector<const Strategy*> &seats, int vowel_price, LogFile *log_file,
+                          BotStats *total) {
+    if (rounds < 1)
+        rounds = 1;
+    if (threads < 1)
+        threads = 1;
+    if (threads > rounds)
+        threads = rounds;
+
+    PhraseIndex index;
+    bool need_index = uses_index(seats);
+    if (need_index)
+        build_phrase_index(corpus, &index);
+
+    vector<BotStats> stats(threads);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i) {
+        long long share = rounds / threads + (i < rounds % threads);
+        workers.push_back(thread(simulate_rounds, share, make_stream(seed, i), &corpus, &seats, vowel_price,
+                                 need_index ? &index : 0, log_file, &stats[i]));
+    }
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    total->wins.assign(seats.size(), 0);
+    total->winnings.assign(seats.size(), 0);
+    total->round_points.assign(seats.size(), 0);
+    for (int i = 0; i < threads; ++i) {
+        total->rounds += stats[i].rounds;
+        total->turns += stats[i].turns;
+        for (size_t s = 0; s < seats.size(); ++s) {
+            total->wins[s] += stats[i].wins[s];
+            total->winnings[s] += stats[i].winnings[s];
+            total->round_points[s] += stats[i].round_points[s];
+        }
+    }
+    return elapsed.count();
+}
+
+/*********************************************************************
+** Function: simulate_rounds
+** Description: Thread body for run_bot_simulation. Installs this
+**   thread's random stream and plays rounds on randomly chosen corpus
+**   phrases, rotating which seat starts each round.
+** Parameters: long long rounds - how many rounds this thread plays.
+**             RandomStream stream - this thread's random stream.
+**             const PhraseStore *corpus - the phrases to draw from.
+**             const vector<const Strategy*> *seats - the bots.
+**             int vowel_price - what a vowel costs.
+**             const PhraseIndex *index - the corpus index, or a null
+**               pointer if no bot uses one.
+**             LogFile *log_file - the event log, or a null pointer. The
+**               thread buffers its events and writes whole rounds.
+**             BotStats *stats - where this thread's results are stored.
+** Pre-Conditions: stats points to a BotStats object that no other
+**   thread writes to.
+** Post-Conditions: stats holds the results of all rounds played.
+** Return: N/A
+*********************************************************************/
+void simulate_rounds(long long rounds, RandomStream stream, const PhraseStore *corpus,
+                     const vector<const Strategy*> *seats, int vowel_price, const PhraseIndex *index,
+                     LogFile *log_file, BotStats *stats) {
+    wheel_rng = stream;
+    EventLog events;
+    events.out = log_file;
+    if (log_file)
+        game_log = &events;
+    int num_seats = seats->size();
+    vector<int> round_score(num_seats);
+    stats->wins.assign(num_seats, 0);
+    stats->winnings.assign(num_seats, 0);
+    stats->round_points.assign(num_seats, 0);
+
+    for (long long r = 0; r < rounds; ++r) {
+        size_t phrase = random_below(&wheel_rng, phrase_count(corpus));
+        int winner = play_bot_round(corpus, phrase, *seats, r % num_seats, vowel_price, index,
+                                    &round_score[0], &stats->turns);
+        ++stats->wins[winner];
+        stats->winnings[winner] += round_score[winner];
+        for (int s = 0; s < num_seats; ++s)
+            stats->round_points[s] += round_score[s];
+    }
+    stats->rounds = rounds;
+    if (log_file)
+        flush_events(&events);
+    game_log = 0;
+}
+
+/*********************************************************************
+** Function: play_bot_round
+** Description: Plays one round between computer players, following the
+**   same rules as play_game and take_turn, without any console input or
+**   output.
+** Parameters: const PhraseStore *corpus - the phrase store.
+**             size_t phrase - which phrase of the store is the secret.
+**             const vector<const Strategy*> &seats - the bots, in turn
+**               order.
+**             int first - the seat that takes the first turn.
+**             int vowel_price - what a vowel costs.
+**             const PhraseIndex *index - the corpus index, or a null
+**               pointer.
+**             int *round_score - one round score per seat.
+**             long long *turns - incremented once per turn taken.
+** Pre-Conditions: phrase is less than phrase_count(corpus) and
+**   round_score has one element per seat.
+** Post-Conditions: round_score holds every seat's score at the end of
+**   the round.
+** Return: The seat that solved the puzzle.
+*********************************************************************/
+int play_bot_round(const PhraseStore *corpus, size_t phrase, const vector<const Strategy*> &seats, int first,
+                   int vowel_price, const PhraseIndex *index, int *round_score, long long *turns) {
+    thread_local Puzzle puzzle;
+    int alphabet[LETTERS_IN_ALPHABET] = {}, c_guessed = 0, v_guessed = 0, num_seats = seats.size();
+    store_puzzle(corpus, phrase, &puzzle);
+    log_round(puzzle.answer, num_seats, vowel_price);
+    for (int s = 0; s < num_seats; ++s)
+        round_score[s] = 0;
+
+    for (int turn = first; ; turn = (turn + 1) % num_seats) {
+        ++*turns;
+        log_turn(turn);
+        if (bot_turn(seats[turn], round_score[turn], puzzle, alphabet, c_guessed, v_guessed, vowel_price, index))
+            return turn;
+    }
+}
+
+/*********************************************************************
+** Function: bot_turn
+** Description: Conducts one turn for a computer player: the bot keeps
+**   choosing actions until it misses, loses its turn on the wheel, or
+**   the puzzle is solved. An action the bot cannot take (spinning when
+**   every consonant is gone, or buying a vowel it cannot afford) is
+**   treated as a solve attempt so that every turn ends. Once every
+**   consonant is on the board a solve attempt always succeeds, so a
+**   round cannot stall when nobody can afford the remaining vowels.
+** Parameters: const Strategy *bot - the player's strategy.
+**             int &score - the player's round score.
+**             Puzzle &puzzle - the secret phrase and the current state
+**               of the board.
+**             int *alphabet - which letters have been guessed.
+**             int &c_guessed - the number of consonants guessed.
+**             int &v_guessed - the number of vowels bought.
+**             int vowel_price - what a vowel costs.
+**             const PhraseIndex *index - the corpus index, or a null
+**               pointer.
+** Pre-Conditions: puzzle was set up by prepare_puzzle, and alphabet has
+**   LETTERS_IN_ALPHABET elements.
+** Post-Conditions: The board, score, and guess history have been
+**   updated.
+** Return: True if the player solved the puzzle, false otherwise.
+*********************************************************************/
+bool bot_turn(const Strategy *bot, int &score, Puzzle &puzzle, int *alphabet, int &c_guessed, int &v_guessed,
+              int vowel_price, const PhraseIndex *index) {
+    while (1) {
+        TurnView view = {&puzzle.board, alphabet, c_guessed, v_guessed, puzzle.hidden, score, vowel_price, index};
+        int choice = bot->choose_action(view, &wheel_rng), found;
+        if (choice == 1 && c_guessed < LETTERS_IN_ALPHABET - NUM_VOWELS) {
+            int wedge = spin_wedge(&wheel, &wheel_rng);
+            log_spin(wheel.kind[wedge], wheel.value[wedge]);
+            if (wheel.kind[wedge] == WEDGE_BANKRUPT)
+                score = 0;
+            if (wheel.kind[wedge] != WEDGE_POINTS)
+                return false;
+            char consonant = bot->choose_letter(view, false, &wheel_rng);
+            ++alphabet[consonant - 'a'];
+            ++c_guessed;
+            found = decode_phrase(puzzle, consonant);
+            log_letter(consonant, found);
+            score += found * wheel.value[wedge];
+            if (!found)
+                return false;
+        }
+        else if (choice == 3 && score >= vowel_price && v_guessed < NUM_VOWELS) {
+            score -= vowel_price;
+            char vowel = bot->choose_letter(view, true, &wheel_rng);
+            ++alphabet[vowel - 'a'];
+            ++v_guessed;
+            log_letter(vowel, decode_phrase(puzzle, vowel));
+        }
+        else {
+            bool solved;
+            if (bot->solve_skill < 0)
+                solved = solve_from_index(view, puzzle.answer);
+            else solved = puzzle.hidden <= bot->solve_skill || c_guessed == LETTERS_IN_ALPHABET - NUM_VOWELS;
+            log_solve(solved);
+            return solved;
+        }
+
+        if (!puzzle.hidden)
+            return true;
+    }
+}
+
+/*********************************************************************
+** Function: print_bot_report
+** Description: Prints each seat's win rate and average scores, followed
+**   by the length of an average round and the simulation's throughput.
+** Parameters: const vector<const Strategy*> &seats - the bots.
+**             const BotStats *stats - the combined results.
+**             double seconds - how long the simulation took.
+** Pre-Conditions: stats holds at least one round.
+** Post-Conditions: The report has been output to the console.
+** Return: N/A
+*********************************************************************/
+void print_bot_report(const vector<const Strategy*> &seats, const BotStats *stats, double seconds) {
+    cout << "Seat  Bot          Win rate   Avg round score   Avg winning score\n";
+    for (size_t s = 0; s < seats.size(); ++s)
+        cout << setw(4) << s + 1 << "  " << left << setw(11) << seats[s]->name << right << fixed
+             << setprecision(2) << setw(9) << 100.0 * stats->wins[s] / stats->rounds << '%'
+             << setw(18) << (double)stats->round_points[s] / stats->rounds
+             << setw(20) << (stats->wins[s] ? (double)stats->winnings[s] / stats->wins[s] : 0.0) << endl;
+    cout << "\nRounds simulated: " << stats->rounds
+         << "\nAverage turns per round: " << (double)stats->turns / stats->rounds
+         << "\nThroughput: " << setprecision(0) << stats->rounds / (seconds > 0 ? seconds : 1e-9) << " rounds/s" << endl;
+}
+
+/*********************************************************************
+** Function: random_action
+** Description: A bot that spins or buys a vowel at random, and only
+**   tries to solve when it can read the board or has nothing else left
+**   to do.
+** Parameters: const TurnView &view - what the bot can see.
+**             RandomStream *rng - the stream to draw from.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: 1 to spin, 2 to solve, or 3 to buy a vowel.
+*********************************************************************/
+int random_action(const TurnView &view, RandomStream *rng) {
+    bool spin = view.c_guessed < LETTERS_IN_ALPHABET - NUM_VOWELS;
+    bool buy = view.round_score >= view.vowel_price && view.v_guessed < NUM_VOWELS;
+    if (view.hidden <= 1 || (!spin && !buy))
+        return 2;
+    if (spin && buy)
+        return random_below(rng, 2) ? 1 : 3;
+    return spin ? 1 : 3;
+}
+
+/*********************************************************************
+** Function: frequency_action
+** Description: A bot that buys a vowel whenever it can afford one,
+**   spins otherwise, and solves once only a few letters are hidden.
+** Parameters: const TurnView &view - what the bot can see.
+**             RandomStream *rng - unused.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: 1 to spin, 2 to solve, or 3 to buy a vowel.
+*********************************************************************/
+int frequency_action(const TurnView &view, RandomStream *rng) {
+    if (view.hidden <= 3)
+        return 2;
+    if (view.round_score >= view.vowel_price && view.v_guessed < NUM_VOWELS)
+        return 3;
+    return (view.c_guessed < LETTERS_IN_ALPHABET - NUM_VOWELS) ? 1 : 2;
+}
+
+/*********************************************************************
+** Function: greedy_action
+** Description: A bot that keeps spinning to build its score, buying
+**   vowels only once the consonants run out.
+** Parameters: const TurnView &view - what the bot can see.
+**             RandomStream *rng - unused.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: 1 to spin, 2 to solve, or 3 to buy a vowel.
+*********************************************************************/
+int greedy_action(const TurnView &view, RandomStream *rng) {
+    if (view.hidden <= 2)
+        return 2;
+    if (view.c_guessed < LETTERS_IN_ALPHABET - NUM_VOWELS)
+        return 1;
+    return (view.round_score >= view.vowel_price && view.v_guessed < NUM_VOWELS) ? 3 : 2;
+}
+
+/*********************************************************************
+** Function: random_letter
+** Description: Picks an unguessed vowel or consonant at random.
+** Parameters: const TurnView &view - what the bot can see.
+**             bool vowel_flag - pick a vowel (true) or a consonant
+**               (false).
+**             RandomStream *rng - the stream to draw from.
+** Pre-Conditions: At least one letter of the requested kind is unguessed.
+** Post-Conditions: N/A
+** Return: An unguessed lowercase letter of the requested kind.
+*********************************************************************/
+char random_letter(const TurnView &view, bool vowel_flag, RandomStream *rng) {
+    int left = (vowel_flag ? NUM_VOWELS - view.v_guessed : LETTERS_IN_ALPHABET - NUM_VOWELS - view.c_guessed);
+    int pick = random_below(rng, left);
+    for (int pos = 0; pos < LETTERS_IN_ALPHABET; ++pos)
+        if (is_vowel(pos) == vowel_flag && !view.alphabet[pos] && !pick--)
+            return 'a' + pos;
+    assert(false);
+    return 0;
+}
+
+/*********************************************************************
+** Function: frequency_letter
+** Description: Picks the most common unguessed vowel or consonant, in
+**   order of letter frequency in English text.
+** Parameters: const TurnView &view - what the bot can see.
+**             bool vowel_flag - pick a vowel (true) or a consonant
+**               (false).
+**             RandomStream *rng - unused.
+** Pre-Conditions: At least one letter of the requested kind is unguessed.
+** Post-Conditions: N/A
+** Return: An unguessed lowercase letter of the requested kind.
+*********************************************************************/
+char frequency_letter(const TurnView &view, bool vowel_flag, RandomStream *rng) {
+    const char *order = (vowel_flag ? "eaoiu" : "tnshrdlcmwfgypbvkjxqz");
+    for (int i = 0; order[i]; ++i)
+        if (!view.alphabet[order[i] - 'a'])
+            return order[i];
+    assert(false);
+    return 0;
+}
+
+/*********************************************************************
+** Function: build_phrase_index
+** Description: Groups the phrases of a dictionary by shape and records
+**   the set of letters in each phrase, along with its letter_depth
+**   masks. Groups of at least BITMAP_GROUP_SIZE phrases also get a
+**   bitmap over their members for every letter that occurs at each
+**   position, up to BITMAP_MAX_BYTES per group; smaller groups are
+**   cheaper to check one phrase at a time.
+** Parameters: const PhraseStore &store - the dictionary of valid
+**               phrases, which must outlive the index.
+**             PhraseIndex *index - the index to be built.
+** Pre-Conditions: index points to an empty PhraseIndex.
+** Post-Conditions: Every phrase is in exactly one shape group.
+** Return: N/A
+*********************************************************************/
+void build_phrase_index(const PhraseStore &store, PhraseIndex *index) {
+    size_t count = phrase_count(&store);
+    index->store = &store;
+    index->letter_depth.assign(count * LETTER_DEPTH, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const char *phrase = &store.text[store.offsets[i]];
+        size_t length = store.offsets[i + 1] - store.offsets[i];
+        ShapeGroup &group = index->shapes[store.boards.substr(store.offsets[i], length)];
+        group.phrases.push_back(i);
+        group.letters.push_back(letter_set(phrase, length));
+
+        uint32_t *depth = &index->letter_depth[i * LETTER_DEPTH];
+        for (size_t j = 0; j < length; ++j)
+            if (is_alphabetic(phrase[j])) {
+                uint32_t bit = 1u << ((phrase[j] | 32) - 'a');
+                int k = 0;
+                while (k < LETTER_DEPTH && (depth[k] & bit))
+                    ++k;
+                if (k < LETTER_DEPTH)
+                    depth[k] |= bit;
+            }
+    }
+
+    for (unordered_map<string, ShapeGroup>::iterator it = index->shapes.begin(); it != index->shapes.end(); ++it) {
+        ShapeGroup &group = it->second;
+        if (group.phrases.size() < BITMAP_GROUP_SIZE)
+            continue;
+        size_t length = it->first.length();
+        group.words = (group.phrases.size() + 63) / 64;
+        group.rows.assign(length * LETTERS_IN_ALPHABET, ROW_EMPTY);
+        for (size_t m = 0; m < group.phrases.size(); ++m) {
+            const char *phrase = &store.text[store.offsets[group.phrases[m]]];
+            for (size_t pos = 0; pos < length; ++pos)
+                if (is_alphabetic(phrase[pos]))
+                    group.rows[pos * LETTERS_IN_ALPHABET + ((phrase[pos] | 32) - 'a')] = 0;
+        }
+
+        // Number the rows that occur, a whole position at a time, until
+        // the next position would not fit in the budget.
+        uint32_t num_rows = 0;
+        size_t max_rows = BITMAP_MAX_BYTES / (group.words * sizeof(uint64_t));
+        for (size_t pos = 0; pos < length; ++pos) {
+            uint32_t *row = &group.rows[pos * LETTERS_IN_ALPHABET];
+            int needed = 0;
+            for (int c = 0; c < LETTERS_IN_ALPHABET; ++c)
+                needed += (row[c] == 0);
+            for (int c = 0; c < LETTERS_IN_ALPHABET; ++c) {
+                if (num_rows + needed > max_rows)
+                    row[c] = ROW_NONE;
+                else if (row[c] == 0)
+                    row[c] = num_rows++;
+            }
+        }
+
+        group.position_bits.assign((size_t)num_rows * group.words, 0);
+        for (size_t m = 0; m < group.phrases.size(); ++m) {
+            const char *phrase = &store.text[store.offsets[group.phrases[m]]];
+            for (size_t pos = 0; pos < length; ++pos)
+                if (is_alphabetic(phrase[pos])) {
+                    uint32_t row = group.rows[pos * LETTERS_IN_ALPHABET + ((phrase[pos] | 32) - 'a')];
+                    if (row != ROW_NONE)
+                        group.position_bits[(size_t)row * group.words + m / 64] |= (uint64_t)1 << (m % 64);
+                }
+        }
+    }
+}
+
+/*********************************************************************
+** Function: phrase_shape
+** Description: Returns the shape of a phrase or board: a copy in which
+**   every letter is replaced by '_', as censure_phrase does, so that a
+**   board and all the phrases it could hide share the same shape.
+** Parameters: const string &s - the phrase or board.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The shape of s.
+*********************************************************************/
+string phrase_shape(const string &s) {
+    string shape = s;
+    censure_phrase(shape);
+    return shape;
+}
+
+/*********************************************************************
+** Function: letter_set
+** Description: Returns which letters appear in a string, ignoring case.
+** Parameters: const char *s - the string to examine.
+**             size_t length - the number of characters in s.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: A 26-bit mask in which bit i is set if the i-th letter of the
+**   alphabet appears in s.
+*********************************************************************/
+uint32_t letter_set(const char *s, size_t length) {
+    uint32_t set = 0;
+    for (size_t i = 0; i < length; ++i)
+        if (is_alphabetic(s[i]))
+            set |= 1u << ((s[i] | 32) - 'a');
+    return set;
+}
+
+/*********************************************************************
+** Function: find_candidates
+** Description: Finds every indexed phrase that the board could be
+**   hiding: it has the board's shape, the revealed letters in the same
+**   places, and none of the guessed letters in the hidden places.
+**   Bitmap groups first AND together the bitmaps of the revealed
+**   positions that have them (a revealed letter that no member has at
+**   that position rules out the whole group), then drop phrases
+**   containing a guessed letter that is not on the board, and only the
+**   survivors are checked in full.
+** Parameters: const PhraseIndex *index - the dictionary's index.
+**             const string &board - the current state of the board.
+**             const int *alphabet - which letters have been guessed.
+**             vector<int> *out - receives the dictionary indices of the
+**               matching phrases.
+** Pre-Conditions: alphabet has LETTERS_IN_ALPHABET elements.
+** Post-Conditions: out holds the matching phrases in dictionary order.
+** Return: The number of matching phrases.
+*********************************************************************/
+int find_candidates(const PhraseIndex *index, const string &board, const int *alphabet, vector<int> *out) {
+    out->clear();
+    unordered_map<string, ShapeGroup>::const_iterator it = index->shapes.find(phrase_shape(board));
+    if (it == index->shapes.end())
+        return 0;
+    const ShapeGroup &group = it->second;
+    const PhraseStore &store = *index->store;
+
+    uint32_t revealed = letter_set(board.data(), board.length()), guessed = revealed;
+    for (int i = 0; i < LETTERS_IN_ALPHABET; ++i)
+        if (alphabet[i])
+            guessed |= 1u << i;
+    uint32_t absent = guessed & ~revealed;
+
+    if (!group.words) {
+        for (size_t m = 0; m < group.phrases.size(); ++m)
+            if (!(group.letters[m] & absent) && matches_board(&store.text[store.offsets[group.phrases[m]]], board, guessed))
+                out->push_back(group.phrases[m]);
+        return out->size();
+    }
+
+    vector<uint64_t> alive(group.words, ~(uint64_t)0);
+    if (group.phrases.size() % 64)
+        alive[group.words - 1] = ((uint64_t)1 << (group.phrases.size() % 64)) - 1;
+    for (size_t pos = 0; pos < board.length(); ++pos)
+        if (is_alphabetic(board[pos])) {
+            uint32_t row = group.rows[pos * LETTERS_IN_ALPHABET + ((board[pos] | 32) - 'a')];
+            if (row == ROW_EMPTY)
+                return 0;
+            if (row == ROW_NONE)
+                continue;
+            const uint64_t *bits = &group.position_bits[(size_t)row * group.words];
+            for (int w = 0; w < group.words; ++w)
+                alive[w] &= bits[w];
+        }
+    for (int w = 0; w < group.words; ++w)
+        for (uint64_t bits = alive[w]; bits; bits &= bits - 1) {
+            int m = w * 64 + __builtin_ctzll(bits);
+            if (!(group.letters[m] & absent) && matches_board(&store.text[store.offsets[group.phrases[m]]], board, guessed))
+                out->push_back(group.phrases[m]);
+        }
+    return out->size();
+}
+
+/*********************************************************************
+** Function: matches_board
+** Description: Checks one phrase of the board's shape against the board.
+** Parameters: const char *phrase - the phrase to check.
+**             const string &board - the current state of the board.
+**             uint32_t guessed - mask of every letter that has been
+**               guessed, including those on the board.
+** Pre-Conditions: phrase and board have the same shape.
+** Post-Conditions: N/A
+** Return: True if every revealed letter matches and no hidden position
+**   holds a guessed letter, false otherwise.
+*********************************************************************/
+bool matches_board(const char *phrase, const string &board, uint32_t guessed) {
+    for (size_t i = 0; i < board.length(); ++i) {
+        if (board[i] == '_') {
+            if (guessed & (1u << ((phrase[i] | 32) - 'a')))
+                return false;
+        }
+        else if (is_alphabetic(board[i]) && (board[i] | 32) != (phrase[i] | 32))
+            return false;
+    }
+    return true;
+}
+
+/*********************************************************************
+** Function: print_candidates
+** Description: Indexes the corpus and prints every phrase that fits the
+**   board and the unguessed letters ranked by how many letters they are
+**   expected to reveal, followed by how long the index took to build and
+**   the query (including the ranking) took to answer.
+** Parameters: const PhraseStore &corpus - the dictionary.
+**             const char *board - the board, with '_' for hidden letters.
+**             const char *guessed - letters called that are not on the
+**               board (letters on the board count as guessed anyway).
+** Pre-Conditions: N/A
+** Post-Conditions: The candidates have been output to the console.
+** Return: N/A
+*********************************************************************/
+void print_candidates(const PhraseStore &corpus, const char *board, const char *guessed) {
+    int alphabet[LETTERS_IN_ALPHABET] = {};
+    for (int i = 0; guessed[i]; ++i)
+        if (is_alphabetic(guessed[i]))
+            alphabet[(guessed[i] | 32) - 'a'] = 1;
+    for (int i = 0; board[i]; ++i)
+        if (is_alphabetic(board[i]))
+            alphabet[(board[i] | 32) - 'a'] = 1;
+
+    PhraseIndex index;
+    vector<int> matches;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    build_phrase_index(corpus, &index);
+    chrono::steady_clock::time_point built = chrono::steady_clock::now();
+    find_candidates(&index, board, alphabet, &matches);
+    vector<LetterScore> ranking;
+    rank_letters(&index, matches, alphabet, &ranking);
+    chrono::duration<double> build_time = built - start, query_time = chrono::steady_clock::now() - built;
+
+    for (size_t i = 0; i < matches.size(); ++i)
+        cout << store_phrase(&corpus, matches[i]) << endl;
+    if (!ranking.empty())
+        cout << "\nLetter  In phrase  Expected reveals  Info gain (bits)\n";
+    for (size_t i = 0; i < ranking.size(); ++i)
+        cout << setw(6) << ranking[i].letter << fixed << setprecision(2) << setw(10) << 100 * ranking[i].probability
+             << '%' << setw(18) << ranking[i].reveals << setw(17) << setprecision(3) << ranking[i].gain << endl;
+    cout << "\nCandidates: " << matches.size() << " of " << phrase_count(&corpus) << " phrases ("
+         << index.shapes.size() << " shapes)"
+         << fixed << setprecision(1) << "\nIndex built in " << build_time.count() * 1e3 << " ms"
+         << setprecision(3) << "\nQuery answered in " << query_time.count() * 1e3 << " ms" << endl;
+}
+
+/*********************************************************************
+** Function: count_letters
+** Description: Adds up, for each letter, how many of the masks have its
+**   bit set. With SSE2 the masks are counted four at a time with
+**   bit-sliced counters: plane k holds bit k of every letter's count in
+**   each lane, so adding a mask is a chain of ANDs and XORs and no
+**   letter is handled on its own until the planes are flushed every
+**   2^COUNTER_PLANES - 1 rows. Without SSE2 (and for the last few
+**   masks) each set bit is counted directly.
+** Parameters: const uint32_t *masks - the letter masks to count.
+**             size_t n - the number of masks.
+**             long long *counts - LETTERS_IN_ALPHABET running totals.
+** Pre-Conditions: masks has n elements.
+** Post-Conditions: counts[i] has grown by the number of masks with bit
+**   i set.
+** Return: N/A
+*********************************************************************/
+void count_letters(const uint32_t *masks, size_t n, long long *counts) {
+    size_t i = 0;
+#ifdef __SSE2__
+    while (n - i >= 4) {
+        __m128i plane[COUNTER_PLANES];
+        for (int k = 0; k < COUNTER_PLANES; ++k)
+            plane[k] = _mm_setzero_si128();
+        size_t rows = min((n - i) / 4, ((size_t)1 << COUNTER_PLANES) - 1);
+        for (size_t r = 0; r < rows; ++r, i += 4) {
+            __m128i carry = _mm_loadu_si128((const __m128i*)(masks + i));
+            for (int k = 0; k < COUNTER_PLANES; ++k) {
+                __m128i next = _mm_and_si128(plane[k], carry);
+                plane[k] = _mm_xor_si128(plane[k], carry);
+                carry = next;
+            }
+        }
+        for (int k = 0; k < COUNTER_PLANES; ++k) {
+            uint32_t lanes[4];
+            _mm_storeu_si128((__m128i*)lanes, plane[k]);
+            for (int lane = 0; lane < 4; ++lane)
+                for (uint32_t bits = lanes[lane]; bits; bits &= bits - 1)
+                    counts[__builtin_ctz(bits)] += 1LL << k;
+        }
+    }
+#endif
+    for (; i < n; ++i)
+        for (uint32_t bits = masks[i]; bits; bits &= bits - 1)
+            ++counts[__builtin_ctz(bits)];
+}
+
+/*********************************************************************
+** Function: rank_letters
+** Description: Scores every unguessed letter over a set of candidate
+**   phrases: the chance it appears at all, the number of letters it is
+**   expected to reveal, and how much calling it tells about which
+**   candidate is the answer (the entropy of "in the phrase or not").
+**   The counts come from the candidates' letter_depth masks, so the
+**   expected reveals are exact for letters that appear at most
+**   LETTER_DEPTH times in a phrase.
+** Parameters: const PhraseIndex *index - the dictionary's index.
+**             const vector<int> &candidates - the candidate phrases, as
+**               returned by find_candidates.
+**             const int *alphabet - which letters have been guessed.
+**             vector<LetterScore> *ranking - receives the scores, best
+**               letter first.
+** Pre-Conditions: alphabet has LETTERS_IN_ALPHABET elements.
+** Post-Conditions: ranking holds one entry per unguessed letter, or is
+**   empty if there are no candidates.
+** Return: N/A
+*********************************************************************/
+void rank_letters(const PhraseIndex *index, const vector<int> &candidates, const int *alphabet,
+                  vector<LetterScore> *ranking) {
+    ranking->clear();
+    if (candidates.empty())
+        return;
+
+    vector<uint32_t> present(candidates.size()), deeper(candidates.size() * (LETTER_DEPTH - 1));
+    for (size_t c = 0; c < candidates.size(); ++c) {
+        const uint32_t *depth = &index->letter_depth[(size_t)candidates[c] * LETTER_DEPTH];
+        present[c] = depth[0];
+        for (int k = 1; k < LETTER_DEPTH; ++k)
+            deeper[c * (LETTER_DEPTH - 1) + k - 1] = depth[k];
+    }
+    long long in_phrase[LETTERS_IN_ALPHABET] = {}, extra[LETTERS_IN_ALPHABET] = {};
+    count_letters(present.data(), present.size(), in_phrase);
+    count_letters(deeper.data(), deeper.size(), extra);
+
+    double n = candidates.size();
+    for (int i = 0; i < LETTERS_IN_ALPHABET; ++i) {
+        if (alphabet[i])
+            continue;
+        LetterScore score;
+        score.letter = 'a' + i;
+        score.probability = in_phrase[i] / n;
+        score.reveals = (in_phrase[i] + extra[i]) / n;
+        score.gain = 0;
+        if (score.probability > 0 && score.probability < 1)
+            score.gain = -score.probability * log2(score.probability)
+                         - (1 - score.probability) * log2(1 - score.probability);
+        ranking->push_back(score);
+    }
+    sort(ranking->begin(), ranking->end(), better_letter);
+}
+
+/*********************************************************************
+** Function: better_letter
+** Description: Orders letter scores by expected reveals, then by
+**   information gain, then alphabetically.
+** Parameters: const LetterScore &a - the first score.
+**             const LetterScore &b - the second score.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if a should be called before b, false otherwise.
+*********************************************************************/
+bool better_letter(const LetterScore &a, const LetterScore &b) {
+    if (a.reveals != b.reveals)
+        return a.reveals > b.reveals;
+    if (a.gain != b.gain)
+        return a.gain > b.gain;
+    return a.letter < b.letter;
+}
+
+/*********************************************************************
+** Function: analyze_board
+** Description: Finds the candidates for the board a bot is looking at
+**   and ranks the unguessed letters over them, unless this thread has
+**   already done so for the same index, board, and guessed letters.
+** Parameters: const TurnView &view - what the bot can see.
+** Pre-Conditions: view.index is not null.
+** Post-Conditions: N/A
+** Return: The analysis, valid until this thread's next call.
+*********************************************************************/
+const BoardAnalysis& analyze_board(const TurnView &view) {
+    thread_local BoardAnalysis analysis;
+    uint32_t guessed = 0;
+    for (int i = 0; i < LETTERS_IN_ALPHABET; ++i)
+        if (view.alphabet[i])
+            guessed |= 1u << i;
+    if (analysis.index == view.index && analysis.guessed == guessed && analysis.board == *view.board)
+        return analysis;
+
+    analysis.index = view.index;
+    analysis.board = *view.board;
+    analysis.guessed = guessed;
+    find_candidates(view.index, *view.board, view.alphabet, &analysis.candidates);
+    rank_letters(view.index, analysis.candidates, view.alphabet, &analysis.ranking);
+    return analysis;
+}
+
+/*********************************************************************
+** Function: best_letter
+** Description: Returns the best unguessed letter of the requested kind
+**   for the board a bot is looking at.
+** Parameters: const TurnView &view - what the bot can see.
+**             bool vowel_flag - pick a vowel (true) or a consonant
+**               (false).
+** Pre-Conditions: view.index is not null and at least one letter of the
+**   requested kind is unguessed.
+** Post-Conditions: N/A
+** Return: The score of the best letter, or the most common unguessed
+**   letter with a zero score if no candidate fits the board.
+*********************************************************************/
+LetterScore best_letter(const TurnView &view, bool vowel_flag) {
+    const vector<LetterScore> &ranking = analyze_board(view).ranking;
+    for (size_t i = 0; i < ranking.size(); ++i)
+        if (is_vowel(ranking[i].letter - 'a') == vowel_flag)
+            return ranking[i];
+    LetterScore fallback = {frequency_letter(view, vowel_flag, 0), 0, 0, 0};
+    return fallback;
+}
+
+/*********************************************************************
+** Function: smart_action
+** Description: A bot that reads the corpus index: it solves once only
+**   one phrase fits the board, buys a vowel when one is more likely than
+**   not to be in the phrase, and otherwise spins while a consonant could
+**   still reveal something. Without an index it plays like the
+**   frequency bot.
+** Parameters: const TurnView &view - what the bot can see.
+**             RandomStream *rng - passed on to the fallback strategy.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: 1 to spin, 2 to solve, or 3 to buy a vowel.
+*********************************************************************/
+int smart_action(const TurnView &view, RandomStream *rng) {
+    if (!view.index)
+        return frequency_action(view, rng);
+    if (analyze_board(view).candidates.size() <= 1)
+        return 2;
+    bool spin = view.c_guessed < LETTERS_IN_ALPHABET - NUM_VOWELS;
+    bool buy = view.round_score >= view.vowel_price && view.v_guessed < NUM_VOWELS;
+    if (buy && best_letter(view, true).probability >= 0.5)
+        return 3;
+    if (spin && best_letter(view, false).probability > 0)
+        return 1;
+    return buy ? 3 : 2;
+}
+
+/*********************************************************************
+** Function: smart_letter
+** Description: Picks the unguessed letter of the requested kind that is
+**   expected to reveal the most letters over the phrases that still fit
+**   the board.
+** Parameters: const TurnView &view - what the bot can see.
+**             bool vowel_flag - pick a vowel (true) or a consonant
+**               (false).
+**             RandomStream *rng - passed on to the fallback strategy.
+** Pre-Conditions: At least one letter of the requested kind is unguessed.
+** Post-Conditions: N/A
+** Return: An unguessed lowercase letter of the requested kind.
+*********************************************************************/
+char smart_letter(const TurnView &view, bool vowel_flag, RandomStream *rng) {
+    if (!view.index)
+        return frequency_letter(view, vowel_flag, rng);
+    return best_letter(view, vowel_flag).letter;
+}
+
+/*********************************************************************
+** Function: solve_from_index
+** Description: Makes a bot's solve attempt by naming the first indexed
+**   phrase that fits the board.
+** Parameters: const TurnView &view - what the bot can see.
+**             const string &answer - the secret phrase.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if the named phrase is the answer, false otherwise
+**   (including when there is no index).
+*********************************************************************/
+bool solve_from_index(const TurnView &view, const string &answer) {
+    if (!view.index)
+        return false;
+    const vector<int> &candidates = analyze_board(view).candidates;
+    if (candidates.empty())
+        return false;
+    return case_insensitive_compare(answer, store_phrase(view.index->store, candidates[0]));
+}
+
+/*********************************************************************
+** Function: uses_index
+** Description: Checks whether any of the bots needs the candidate index.
+** Parameters: const vector<const Strategy*> &seats - the bots.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if a bot solves from the index, false otherwise.
+*********************************************************************/
+bool uses_index(const vector<const Strategy*> &seats) {
+    for (size_t s = 0; s < seats.size(); ++s)
+        if (seats[s]->solve_skill < 0)
+            return true;
+    return false;
+}
+
+/*********************************************************************
+** Function: run_tournament
+** Description: Plays a knockout tournament. Each stage seats the
+**   remaining players at tables of at most table_size, every table
+**   plays its rounds headlessly (tables are shared out among the worker
+**   threads), and each table's top scorer moves on. The stage with a
+**   single table is the final.
+** Parameters: Tournament *t - the tournament, with its players, bots,
+**               corpus, and rules set.
+**             int table_size - the most players at one table.
+**             int threads - the number of worker threads to use.
+** Pre-Conditions: t has at least one player and one bot, and
+**   table_size is at least 2.
+** Post-Conditions: Every player's total_score holds the points they
+**   banked, the standings are up to date, and the stage, table,
+**   champion, and timing fields of t are filled in.
+** Return: N/A
+*********************************************************************/
+void run_tournament(Tournament *t, int table_size, int threads) {
+    int num_p = t->players.size();
+    t->round_wins.assign(num_p, 0);
+    init_standings(&t->standings, num_p, &t->players[0]);
+    vector<int> alive(num_p);
+    for (int i = 0; i < num_p; ++i)
+        alive[i] = i;
+    if (threads < 1)
+        threads = 1;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (1) {
+        Stage stage;
+        seat_stage(t, alive, table_size, &stage);
+        atomic<int> next_table(0);
+        vector<thread> workers;
+        for (int w = 0; w < min(threads, (int)stage.tables.size()); ++w)
+            workers.push_back(thread(play_tables, t, &stage, t->tables_played, &next_table));
+        for (size_t w = 0; w < workers.size(); ++w)
+            workers[w].join();
+
+        for (int i = 0; i < num_p; ++i) {
+            t->players[i].total_score += stage.points[i];
+            t->round_wins[i] += stage.round_wins[i];
+        }
+        sort_standings(&t->standings);
+        ++t->stages;
+        t->tables_played += stage.tables.size();
+        if (stage.tables.size() == 1) {
+            t->champion = stage.winners[0];
+            break;
+        }
+        alive = stage.winners;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    t->seconds = elapsed.count();
+}
+
+/*********************************************************************
+** Function: seat_stage
+** Description: Seats the remaining players of a tournament at the
+**   stage's tables. Players are seeded by their current standing and
+**   dealt out in a snake (1, 2, ..., n, n, ..., 2, 1, ...) so that
+**   every table gets a similar mix of strong and weak players.
+** Parameters: const Tournament *t - the tournament.
+**             const vector<int> &alive - the players still in.
+**             int table_size - the most players at one table.
+**             Stage *stage - the stage to set up.
+** Pre-Conditions: alive is not empty and the standings are up to date.
+** Post-Conditions: stage has its tables and empty results.
+** Return: N/A
+*********************************************************************/
+void seat_stage(const Tournament *t, const vector<int> &alive, int table_size, Stage *stage) {
+    vector<int> seeded = alive;
+    const vector<int> &rank = t->standings.rank;
+    sort(seeded.begin(), seeded.end(), [&rank](int a, int b) { return rank[a] < rank[b]; });
+
+    int num_seeded = seeded.size(), tables = (num_seeded + table_size - 1) / table_size;
+    stage->tables.assign(tables, vector<int>());
+    for (int k = 0; k < num_seeded; ++k) {
+        int lap = k / tables, column = k % tables;
+        stage->tables[lap % 2 ? tables - 1 - column : column].push_back(seeded[k]);
+    }
+    stage->winners.assign(tables, -1);
+    stage->points.assign(t->players.size(), 0);
+    stage->round_wins.assign(t->players.size(), 0);
+}
+
+/*********************************************************************
+** Function: play_tables
+** Description: Thread body for run_tournament. Claims tables of the
+**   stage one at a time and plays each table's rounds with play_bot_round.
+**   Only a round's winner banks their round score, as in play_game, and
+**   the player who banked the most (the higher seed on a tie) wins the
+**   table. Each table draws from its own stream, numbered across the
+**   whole tournament, so results do not depend on the thread count.
+** Parameters: const Tournament *t - the tournament.
+**             Stage *stage - the stage being played.
+**             int first_table - the tournament-wide number of the
+**               stage's first table.
+**             atomic<int> *next_table - the next unclaimed table.
+** Pre-Conditions: stage was set up by seat_stage.
+** Post-Conditions: Every table claimed by this thread has its winner,
+**   points, and round wins recorded in stage.
+** Return: N/A
+*********************************************************************/
+void play_tables(const Tournament *t, Stage *stage, int first_table, atomic<int> *next_table) {
+    vector<const Strategy*> seats;
+    vector<int> round_score;
+    vector<long long> banked;
+    long long turns = 0;
+    for (int table; (table = next_table->fetch_add(1)) < (int)stage->tables.size(); ) {
+        const vector<int> &players = stage->tables[table];
+        int num_seats = players.size(), best = 0;
+        wheel_rng = make_stream(t->seed, first_table + table);
+        seats.clear();
+        for (int s = 0; s < num_seats; ++s)
+            seats.push_back(t->bots[players[s] % t->bots.size()]);
+        round_score.assign(num_seats, 0);
+        banked.assign(num_seats, 0);
+
+        for (int r = 0; r < t->rounds; ++r) {
+            size_t phrase = random_below(&wheel_rng, phrase_count(t->corpus));
+            int winner = play_bot_round(t->corpus, phrase, seats, r % num_seats, t->vowel_price, t->index,
+                                        &round_score[0], &turns);
+            banked[winner] += round_score[winner];
+            ++stage->round_wins[players[winner]];
+        }
+        for (int s = 0; s < num_seats; ++s) {
+            stage->points[players[s]] = banked[s];
+            if (banked[s] > banked[best])
+                best = s;
+        }
+        stage->winners[table] = players[best];
+    }
+}
+
+/*********************************************************************
+** Function: print_tournament_report
+** Description: Prints the top of the final standings, the champion,
+**   optionally one player's place, and the size and speed of the
+**   tournament.
+** Parameters: const Tournament *t - the finished tournament.
+**             int top - how many places to print.
+**             int player - the number of a player whose place should be
+**               printed, or 0 for none.
+** Pre-Conditions: run_tournament has finished.
+** Post-Conditions: The report has been output to the console.
+** Return: N/A
+*********************************************************************/
+void print_tournament_report(const Tournament *t, int top, int player) {
+    const Standings &standings = t->standings;
+    int num_p = t->players.size(), rounds = t->tables_played * t->rounds;
+    cout << "Rank  Player  Bot            Total  Round wins\n";
+    for (int i = 0; i < min(top, num_p); ++i) {
+        int p = standings.order[i];
+        cout << setw(4) << i + 1 << setw(8) << t->players[p].number << "  " << left << setw(11)
+             << t->bots[p % t->bots.size()]->name << right << setw(9) << t->players[p].total_score
+             << setw(12) << t->round_wins[p] << endl;
+    }
+    int champion = t->champion;
+    cout << "\nChampion: Player " << t->players[champion].number << " ("
+         << t->bots[champion % t->bots.size()]->name << ")\n";
+    if (player >= 1 && player <= num_p)
+        cout << "Player " << player << " placed " << standings.rank[player - 1] + 1 << " of " << num_p
+             << " with " << t->players[player - 1].total_score << " points.\n";
+    cout << "\nPlayers: " << num_p << "\nStages: " << t->stages << "\nTables played: " << t->tables_played
+         << "\nRounds played: " << rounds << fixed << setprecision(0)
+         << "\nThroughput: " << rounds / (t->seconds > 0 ? t->seconds : 1e-9) << " rounds/s" << endl;
+}
+
+/*********************************************************************
+** Function: run_host
+** Description: Hosts one interactive game per input stream named in a
+**   list file, all at once in a single thread. An event loop polls every
+**   stream that is still open, reads whatever has arrived, and lets each
+**   game act on its complete lines; a game never waits on another game's
+**   player. Each game gets its own random stream, numbered by its place
+**   in the list, so a set of scripts always plays out the same way. The
+**   output of all games is gathered and written once per pass.
+** Parameters: const char *list - the file listing one input per line: a
+**               script, a named pipe, or "-" for stdin.
+**             const PhraseStore *bank - phrases to draw every game's
+**               secret phrases from, or a null pointer to read them.
+**             uint64_t seed - the run's seed.
+** Pre-Conditions: The wheel has been set up.
+** Post-Conditions: Every game has finished, or its input has ended, and
+**   a summary has been output to the console.
+** Return: True if the list could be read, false otherwise.
+*********************************************************************/
+bool run_host(const char *list, const PhraseStore *bank, uint64_t seed) {
+    ifstream in(list);
+    if (!in)
+        return false;
+    vector<string> paths;
+    string path, out;
+    while (getline(in, path))
+        if (!path.empty())
+            paths.push_back(path);
+
+    // Every game holds a descriptor open, so use as many as allowed.
+    rlimit limit;
+    if (!getrlimit(RLIMIT_NOFILE, &limit)) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int num_games = paths.size(), unopened = 0, abandoned = 0;
+    vector<HostedGame> games(num_games);
+    for (int i = 0; i < num_games; ++i) {
+        HostedGame &g = games[i];
+        g.number = i + 1;
+        g.rng = make_stream(seed, i);
+        g.fd = (paths[i] == "-" ? STDIN_FILENO : open(paths[i].c_str(), O_RDONLY | O_NONBLOCK));
+        if (g.fd < 0) {
+            g.output = "Could not open " + paths[i] + "\n";
+            g.state = GAME_OVER;
+            ++unopened;
+        }
+        else start_game(&g);
+        write_game_output(&g, &out);
+    }
+
+    vector<pollfd> ready;
+    vector<int> owner;
+    char buffer[HOST_READ_SIZE];
+    while (1) {
+        cout << out << flush;
+        out.clear();
+        ready.clear();
+        owner.clear();
+        for (int i = 0; i < num_games; ++i)
+            if (games[i].fd >= 0) {
+                pollfd entry = {games[i].fd, POLLIN, 0};
+                ready.push_back(entry);
+                owner.push_back(i);
+            }
+        if (ready.empty())
+            break;
+        if (poll(&ready[0], ready.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (size_t k = 0; k < ready.size(); ++k) {
+            if (!ready[k].revents)
+                continue;
+            HostedGame &g = games[owner[k]];
+            ssize_t n = read(g.fd, buffer, sizeof(buffer));
+            if (n < 0 && (errno == EAGAIN || errno == EINTR))
+                continue;
+            if (n > 0)
+                g.input.append(buffer, n);
+
+            size_t used = 0, newline;
+            while (g.state != GAME_OVER && (newline = g.input.find('\n', used)) != string::npos) {
+                feed_game(&g, g.input.substr(used, newline - used), bank);
+                used = newline + 1;
+            }
+            g.input.erase(0, used);
+            if (n <= 0 && g.state != GAME_OVER) {
+                if (!g.input.empty())
+                    feed_game(&g, g.input, bank);
+                if (g.state != GAME_OVER) {
+                    g.output += "\nThe input ended before the game did.\n";
+                    g.state = GAME_OVER;
+                    ++abandoned;
+                }
+            }
+            write_game_output(&g, &out);
+
+            // A finished game only keeps its number.
+            if (g.state == GAME_OVER) {
+                if (g.fd != STDIN_FILENO)
+                    close(g.fd);
+                g.fd = -1;
+                vector<Player>().swap(g.players);
+                vector<string>().swap(g.phrases);
+                g.puzzle = Puzzle();
+                string().swap(g.input);
+                string().swap(g.output);
+            }
+        }
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << "\nHosted " << games.size() << " game(s): " << games.size() - unopened - abandoned << " finished, "
+         << abandoned << " ended early, " << unopened << " could not be opened, in " << fixed << setprecision(3)
+         << elapsed.count() << " s" << endl;
+    return true;
+}
+
+/*********************************************************************
+** Function: start_game
+** Description: Begins a hosted game with the setup prompts.
+** Parameters: HostedGame *g - the game.
+** Pre-Conditions: g has its number and random stream.
+** Post-Conditions: g is waiting for its number of players.
+** Return: N/A
+*********************************************************************/
+void start_game(HostedGame *g) {
+    g->output = "Wheel of Fortune Game Setup:\n";
+    g->state = ASK_PLAYERS;
+    prompt_game(g);
+}
+
+/*********************************************************************
+** Function: feed_game
+** Description: Gives one line of input to a hosted game as the answer to
+**   the prompt it is waiting on, plays out everything that follows from
+**   it by the same rules as game_setup, play_game, and take_turn, and
+**   prompts for the next line. An answer that does not fit the prompt is
+**   asked for again, as the interactive game does. A game takes at most
+**   HOST_MAX_PLAYERS players and HOST_MAX_ROUNDS rounds, so that one
+**   bad line cannot exhaust the memory every hosted game shares.
+** Parameters: HostedGame *g - the game.
+**             const string &line - the line, without its newline.
+**             const PhraseStore *bank - the phrase bank, or a null
+**               pointer to read the phrases from the input.
+** Pre-Conditions: g is not over.
+** Post-Conditions: g is waiting on its next prompt, or is over.
+** Return: N/A
+*********************************************************************/
+void feed_game(HostedGame *g, const string &line, const PhraseStore *bank) {
+    string answer(line, 0, line.length() - (!line.empty() && line[line.length() - 1] == '\r'));
+    g->output += answer + '\n';
+    int value;
+    if (g->state == ASK_PLAYERS && parse_integer(answer, HOST_MAX_PLAYERS, &value)) {
+        g->players.assign(value, Player());
+        for (int i = 0; i < value; ++i)
+            g->players[i].number = i + 1;
+        g->state = ASK_ROUNDS;
+    }
+    else if (g->state == ASK_ROUNDS && parse_integer(answer, HOST_MAX_ROUNDS, &value)) {
+        g->num_r = value;
+        g->state = ASK_PHRASE;
+        if (bank)
+            for (int i = 0; i < value; ++i)
+                g->phrases.push_back(store_phrase(bank, random_below(&g->rng, phrase_count(bank))));
+    }
+    else if (g->state == ASK_PHRASE && check_phrase_validity(answer))
+        g->phrases.push_back(answer);
+    else if (g->state == ASK_ACTION && parse_integer(answer, 3, &value)) {
+        Player &p = g->players[g->turn % g->players.size()];
+        if (value == 1 && g->c_guessed >= LETTERS_IN_ALPHABET - NUM_VOWELS)
+            g->output += "\nAll of the consonants have already been guessed.\n";
+        else if (value == 1) {
+            int wedge = spin_wedge(&wheel, &g->rng);
+            g->spin = wheel.value[wedge];
+            if (wheel.kind[wedge] == WEDGE_POINTS) {
+                g->output += "\nYou spun a(n) " + ::to_string(g->spin) + "!\n";
+                ++g->c_guessed;
+                g->state = ASK_CONSONANT;
+            }
+            else {
+                if (wheel.kind[wedge] == WEDGE_BANKRUPT) {
+                    g->output += "\nYou spun Bankrupt!\nYou lose all of your points. ";
+                    p.round_score = 0;
+                }
+                else g->output += "\nYou spun Lose a Turn!\n";
+                g->output += "Your turn is over.\n\n";
+                next_turn(g);
+            }
+        }
+        else if (value == 2) {
+            g->output += "\nEnter the phrase: ";
+            g->state = ASK_SOLUTION;
+        }
+        else if (p.round_score < VOWEL_PRICE)
+            g->output += "\nYou don't have enough points to buy a vowel!\n";
+        else if (g->v_guessed >= NUM_VOWELS)
+            g->output += "\nAll of the vowels have already been bought.\n";
+        else {
+            g->output += '\n';
+            p.round_score -= VOWEL_PRICE;
+            ++g->v_guessed;
+            g->state = ASK_VOWEL;
+        }
+    }
+    else if (g->state == ASK_CONSONANT || g->state == ASK_VOWEL) {
+        size_t first = answer.find_first_not_of(" \t");
+        char letter = (first == string::npos ? 0 : answer[first]);
+        if (letter >= 'A' && letter <= 'Z')
+            letter += 32;
+        int pos = letter - 'a';
+        bool vowel = (g->state == ASK_VOWEL);
+        if (pos >= 0 && pos < LETTERS_IN_ALPHABET && is_vowel(pos) == vowel) {
+            if (g->guessed >> pos & 1)
+                g->output += "That letter has already been chosen this round.\n";
+            else {
+                Player &p = g->players[g->turn % g->players.size()];
+                g->guessed |= 1u << pos;
+                int found = decode_phrase(g->puzzle, letter);
+                if (!vowel)
+                    p.round_score += found * g->spin;
+                if (found == 1)
+                    g->output += string("There is 1 ") + letter;
+                else g->output += "There are " + ::to_string(found) + ' ' + letter + "'s";
+                g->output += " in the phrase.\nScore: " + ::to_string(p.round_score) + '\n';
+                g->state = ASK_ACTION;
+                if (!g->puzzle.hidden) {
+                    g->output += '\n' + g->puzzle.board + "\n\n";
+                    end_hosted_round(g);
+                }
+                else if (!found && !vowel) {
+                    g->output += "Your turn is over.\n\n";
+                    next_turn(g);
+                }
+            }
+        }
+    }
+    else if (g->state == ASK_SOLUTION) {
+        if (answer.length() == g->puzzle.answer.length() && case_insensitive_compare(g->puzzle.answer, answer)) {
+            g->output += "Correct!\n";
+            end_hosted_round(g);
+        }
+        else {
+            g->output += "That is incorrect.\n\n";
+            next_turn(g);
+        }
+    }
+
+    if (g->state == ASK_PHRASE && (int)g->phrases.size() == g->num_r) {
+        g->output += "Let's play, Wheel of Fortune!";
+        g->turn = -1;
+        end_hosted_round(g);
+    }
+    if (g->state != GAME_OVER)
+        prompt_game(g);
+}
+
+/*********************************************************************
+** Function: next_turn
+** Description: Passes a hosted game to its next player.
+** Parameters: HostedGame *g - the game.
+** Pre-Conditions: g has its players.
+** Post-Conditions: g is waiting on the next player's action.
+** Return: N/A
+*********************************************************************/
+void next_turn(HostedGame *g) {
+    ++g->turn;
+    g->output += "Player " + ::to_string(g->players[g->turn % g->players.size()].number) + ':';
+    g->state = ASK_ACTION;
+}
+
+/*********************************************************************
+** Function: end_hosted_round
+** Description: Banks the round score of the player who just solved the
+**   puzzle of a hosted game and starts the next round, or ends the game
+**   with the final standings after the last one. Also starts the first
+**   round, when no round has been played yet.
+** Parameters: HostedGame *g - the game.
+** Pre-Conditions: g has all of its phrases, and the current player (if
+**   a round was being played) has just solved it.
+** Post-Conditions: g is waiting on the first action of the next round,
+**   or is over.
+** Return: N/A
+*********************************************************************/
+void end_hosted_round(HostedGame *g) {
+    int num_p = g->players.size();
+    Standings standings;
+    ostringstream text;
+    if (g->round) {
+        Player &winner = g->players[g->turn % num_p];
+        text << "Player " << winner.number << " won Round " << g->round << ", accumulating " << winner.round_score
+             << " points.\n";
+        winner.total_score += winner.round_score;
+        init_standings(&standings, num_p, &g->players[0]);
+        if (g->round == g->num_r) {
+            declare_winner(&standings, text);
+            g->output += text.str();
+            g->state = GAME_OVER;
+            return;
+        }
+        print_standings(&standings, false, text);
+        g->output += text.str();
+    }
+
+    prepare_puzzle(g->phrases[g->round], &g->puzzle);
+    string().swap(g->phrases[g->round]);
+    ++g->round;
+    g->guessed = 0;
+    g->c_guessed = g->v_guessed = 0;
+    for (int i = 0; i < num_p; ++i)
+        g->players[i].round_score = 0;
+    g->output += "\n\nRound " + ::to_string(g->round) + ":\n\n";
+    next_turn(g);
+}
+
+/*********************************************************************
+** Function: prompt_game
+** Description: Prints the prompt a hosted game is waiting on, showing
+**   the board first when asking for an action, as take_turn does.
+** Parameters: HostedGame *g - the game.
+** Pre-Conditions: g is not over.
+** Post-Conditions: The prompt is at the end of g's output.
+** Return: N/A
+*********************************************************************/
+void prompt_game(HostedGame *g) {
+    switch (g->state) {
+        case ASK_PLAYERS:   g->output += "How many players? ";
+                            break;
+        case ASK_ROUNDS:    g->output += "How many rounds? ";
+                            break;
+        case ASK_PHRASE:    g->output += "Enter round " + ::to_string(g->phrases.size() + 1) + " phrase: ";
+                            break;
+        case ASK_ACTION:    g->output += '\n' + g->puzzle.board + "\n\n"
+                                         "Do you want to spin the wheel(1), solve the puzzle(2), or buy a vowel(3)? ";
+                            break;
+        case ASK_CONSONANT: g->output += "Pick a consonant: ";
+                            break;
+        case ASK_VOWEL:     g->output += "Pick a vowel: ";
+                            break;
+    }
+}
+
+/*********************************************************************
+** Function: parse_integer
+** Description: Reads a whole number between 1 and max_input from a line
+**   of input, accepting the same answers as get_integer.
+** Parameters: const string &line - the line.
+**             int max_input - the largest acceptable value.
+**             int *value - receives the number.
+** Pre-Conditions: max_input is positive.
+** Post-Conditions: N/A
+** Return: True if the line held an acceptable number, false otherwise.
+*********************************************************************/
+bool parse_integer(const string &line, int max_input, int *value) {
+    istringstream in(line);
+    double x;
+    if (!(in >> x) || x < 1.0 || x > max_input || ceil(x) != x)
+        return false;
+    *value = x;
+    return true;
+}
+
+/*********************************************************************
+** Function: write_game_output
+** Description: Moves the complete lines a hosted game has printed to the
+**   host's output, tagging each with the game's number. A prompt still
+**   waiting on its answer stays with the game until the answer is echoed
+**   after it, unless the game is over.
+** Parameters: HostedGame *g - the game.
+**             string *out - the host's output for this pass.
+** Pre-Conditions: N/A
+** Post-Conditions: Only an unfinished line is left in g's output.
 ** Return: N/A
 *********************************************************************/
-void sort_by_total_score(int num_p, Player **standings) {
-    switch (num_p) {
-        case 3: if (standings[0]->total_score < standings[1]->total_score)
-                    swap(standings[0], standings[1]);
-                if (standings[1]->total_score < standings[2]->total_score)
-                    swap(standings[1], standings[2]);
-        case 2: if (standings[0]->total_score < standings[1]->total_score)
-                    swap(standings[0], standings[1]);
-        case 1: break;
+void write_game_output(HostedGame *g, string *out) {
+    size_t begin = 0, newline;
+    string tag = ::to_string(g->number) + "| ";
+    if (g->state == GAME_OVER && !g->output.empty() && g->output[g->output.length() - 1] != '\n')
+        g->output += '\n';
+    while ((newline = g->output.find('\n', begin)) != string::npos) {
+        *out += tag;
+        out->append(g->output, begin, newline + 1 - begin);
+        begin = newline + 1;
     }
+    g->output.erase(0, begin);
 }
@@ -4,66 +4,467 @@
 ** Date: 02/24/2017
 ** Description: Simulates games of bowling.
 ** Input: Number of players and player names. Press enter incessantly.
-** Output: Bowling scoreboard and gameplay text.
+**   Alternatively, pass "--simulate <games>" (optionally followed by
+**   "--threads <n>") to run a headless simulation, or
+**   "--score <file>" ("-" for stdin) to score recorded games, one game
+**   per line in scoreboard notation (e.g. "X 7/ 9- X X 81 ..."), or
+**   "--exact" to compute the exact score distribution (add "--simulate
+**   <games>" to check it against a Monte Carlo run). "--model <file>"
+**   loads per-bowler pin distributions; interactive players whose names
+**   match a profile bowl with it, and "--bowler <name>" selects the
+**   profile used by the simulation and exact modes. "--league <bowlers>"
+**   with "--games <n>" (and optionally "--names <file>") plays a season
+**   of headless league nights. "--history <file>" appends every game
+**   played (interactively or in a league) to a binary game log; with
+**   "--stats", "--top <n>", or "--h2h <name> --vs <name>" it answers
+**   queries from an existing log instead. "--rare <series>" estimates
+**   the probability of a game of at least "--tail <score>" (default 300)
+**   and a three-game series of at least "--series <pins>" (default 800)
+**   by importance sampling with strike probability "--bias <p>".
+**   "--lanes <n>" runs that many independent lane sessions of
+**   "--bowlers <b>" (default 4) for "--games <g>" games each on a
+**   work-stealing thread pool. "--seed <s>" makes any mode, including
+**   the interactive game, reproducible.
+** Output: Bowling scoreboard and gameplay text, aggregate simulation
+**   statistics in simulation mode, or one line of frame scores and the
+**   total per recorded game in scoring mode.
 *********************************************************************/
 
 #include <iostream>     // for cin and cout
 #include <iomanip>      // for setw(), setfill()
-#include <cstring>      // for strlen()
-#include <cmath>        // for ceil()
-#include <cstdlib>      // for rand(), srand()
+#include <cstring>      // for strlen(), strcmp()
+#include <cmath>        // for ceil(), sqrt()
+#include <cstdio>       // for fopen(), fread(), fwrite()
+#include <cstdlib>      // for atoll()
 #include <ctime>        // for time()
+#include <thread>       // for thread
+#include <vector>       // for vector
+#include <chrono>       // for steady_clock
+#include <fstream>      // for ifstream
+#include <sstream>      // for istringstream
+#include <string>       // for string, getline()
+#include <unordered_map> // for unordered_map
+#include <algorithm>    // for partial_sort(), min()
+#include <unistd.h>     // for write(), isatty()
+#include <sys/ioctl.h>  // for ioctl(), winsize
+#include <sys/mman.h>   // for mmap(), munmap()
+#include <sys/stat.h>   // for fstat()
+#include <fcntl.h>      // for open()
+#include <cstdint>      // for uint32_t, int16_t
+#include <atomic>       // for atomic
+#include <mutex>        // for mutex, lock_guard
+#include <deque>        // for deque
+#include "../Common/random.h"
+#include "../Common/alias.h"
 
 #define INT_MAX 2147483647
 #define FINAL_FRAME 9
+#define SPARE 11
+#define SKIP 12
+#define INVALID 13
+#define SCORE_BUFFER_SIZE (1 << 20)
+#define BOARD_WIDTH 84
+#define HISTORY_MAGIC 0x484c5742u   // "BWLH"
+#define HISTORY_VERSION 1
 
 using namespace std;
 
+// Probability of each per-ball outcome: p[new_rack][pins_standing][pins_knocked].
+// new_rack is 1 when the ball is the first thrown at a freshly set rack.
+// threshold[][][] and alias[][][] hold the alias tables used by sample_pins.
+struct PinModel {
+    char name[64] {};
+    double p[2][11][11] {};
+    uint32_t threshold[2][11][11] {};
+    unsigned char alias[2][11][11] {};
+};
+
 class Player {
 public:
     char name[64] {};
     char bowls[21] {};
     int frame_s[10] {};
     int total_s {};
+    const PinModel *model {};
+};
+
+struct SimStats {
+    long long games {};
+    long long histogram[301] {};
+    long long strikes {};
+    long long spares {};
+    long long spare_chances {};
+    long long total_pins {};
+    int high_game {};
+    int low_game {300};
+};
+
+// Off-screen copy of the scoreboard. The board is rendered into next,
+// compared against shown (what the terminal currently displays), and only
+// the changed cells are sent, in one write, through out.
+struct Scoreboard {
+    int num_p {};
+    Player *p_list {};
+    int rows {};
+    bool tty {};
+    bool drawn {};
+    vector<char> shown;
+    vector<char> next;
+    string out;
+};
+
+// Column-oriented store for league play. Names are interned once into
+// name_pool; per-game columns are reused from game to game, and season
+// columns accumulate across games. Bowler i's bowls are
+// bowls[21 * i .. 21 * i + 20] and its frame scores are
+// frame_s[10 * i .. 10 * i + 9].
+struct League {
+    int size {};
+    vector<char> name_pool;
+    vector<int> name_offset;
+    unordered_map<string, int> name_ids;
+    vector<const PinModel*> model;
+
+    vector<char> bowls;
+    vector<int> frame_s;
+    vector<int> total_s;
+
+    vector<int> games_played;
+    vector<long long> season_pins;
+    vector<int> high_game;
+    vector<int> wins;
+};
+
+// On-disk layout of the game log: a HistoryHeader followed by one
+// fixed-size GameRecord per player per game, in the order the games were
+// played. Player names live in a sidecar "<log>.names" file, one per line,
+// and a record's player_id is the line number of its name.
+struct HistoryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+struct GameRecord {
+    uint32_t game_id;
+    uint32_t player_id;
+    int16_t frame_s[10];
+    int16_t total_s;
+    char bowls[21];
+    char reserved[3];
+};
+
+static_assert(sizeof(GameRecord) == 56, "GameRecord must keep its on-disk size");
+
+// Appends games to a log, remembering the ids of names already written.
+struct HistoryWriter {
+    FILE *records {};
+    FILE *names {};
+    uint32_t next_game {};
+    unordered_map<string, uint32_t> ids;
+};
+
+// A read-only, memory-mapped view of a game log.
+struct History {
+    const GameRecord *games {};
+    size_t count {};
+    vector<string> names;
+    void *map {};
+    size_t map_size {};
+};
+
+// Importance-sampling accumulator for one tail event: the sum of the
+// likelihood-ratio weights of the samples that hit it and of their squares.
+struct TailEstimate {
+    long long samples {};
+    long long hits {};
+    double sum {};
+    double sum_sq {};
+};
+
+// One lane of a bowling center: its own players and its position in
+// its session of games. A lane is only ever touched by the worker that
+// currently holds its task.
+struct Lane {
+    vector<Player> players;
+    RandomStream rng {};
+    int first_bowler {};
+    int frame {};
+    int games_left {};
+};
+
+// League standings shared by every lane. Each field is updated with
+// atomic operations so that lanes never wait on each other.
+struct Standings {
+    int size {};
+    atomic<long long> *pins {};
+    atomic<int> *games {};
+    atomic<int> *high {};
+    atomic<int> *wins {};
+};
+
+// One worker's deque of lane tasks. The owner pushes and pops at the
+// back; idle workers steal from the front.
+struct WorkQueue {
+    mutex lock;
+    deque<int> tasks;
+};
+
+// The stream bowl() draws from. Each thread owns its own, so headless
+// games can run in parallel and reproduce exactly from their seed.
+thread_local RandomStream pin_rng;
+
+// Maps a scoreboard character to the pins it stands for. Spares depend
+// on the previous ball, so they get their own code.
+const unsigned char BALL_VALUE[256] = {
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, SKIP,    INVALID, INVALID, INVALID, SKIP,    INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    SKIP,    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,   // ' '
+    INVALID, INVALID, INVALID, INVALID, INVALID, 0,       INVALID, SPARE,     // '-', '/'
+    INVALID, 1,       2,       3,       4,       5,       6,       7,         // '1'-'7'
+    8,       9,       INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,   // '8', '9'
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    10,      INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,   // 'X'
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    10,      INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,   // 'x'
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID,
+    INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID, INVALID
 };
 
 int game_setup(Player**);
 int get_integer(const string&, int max_input = INT_MAX);
 void lets_go_bowling(int, Player*);
-void bowl_frame(int, Player*, int, Player*);
-int bowl(const char*, char*, int, bool);
+void bowl_frame(int, Player*, Scoreboard*);
+int bowl(const char*, char*, int, bool, const PinModel *model = 0);
 void update_score(int, Player*, int, int);
-void fill_balls(Player*, bool, int, Player*);
+void score_ball(int, const char*, int*, int*, int, int);
+void fill_balls(Player*, bool, Scoreboard*);
 void prompt_bowler(const char*);
-void print_scoreboard(int, Player*);
-void spaces(int);
+void init_scoreboard(Scoreboard*, int, Player*);
+void print_scoreboard(Scoreboard*);
+void close_scoreboard(Scoreboard*);
+void render_player(char*, const Player*);
 char space_if_zero(char);
-void print_bowls(Player*);
-void print_scores(Player*);
-void format_score(int, char bowl = 1);
+void put_score(char*, int, int);
 void declare_winner(int, Player*);
 
+const char* find_option(int, char**, const char*);
+bool has_flag(int, char**, const char*);
+double run_simulation(long long, int, uint64_t, const PinModel*, SimStats*);
+void simulate_games(long long, RandomStream, const PinModel*, SimStats*);
+void simulate_game(Player*);
+void simulate_columns(char*, int*, int*, const PinModel*);
+void record_game(const Player*, SimStats*);
+void merge_stats(SimStats*, const SimStats*);
+void print_simulation_report(const SimStats*, double);
+
+void score_file(const char*);
+const char* parse_game(const char*, const char*, int*);
+void score_balls(const int*, Player*);
+char* append_int(char*, int);
+
+void uniform_pin_model(PinModel*);
+void exact_distribution(const PinModel*, double*);
+void add_frame(const PinModel*, const double[4][301], double[4][301], bool);
+void print_exact_report(const double*, const SimStats*);
+
+bool load_pin_models(const char*, vector<PinModel>&);
+void build_alias_tables(PinModel*);
+int sample_pins(const PinModel*, int, bool);
+const PinModel* find_pin_model(const vector<PinModel>&, const char*);
+
+int intern_name(League*, const char*);
+const char* league_name(const League*, int);
+void play_league_game(League*);
+int league_leader(const League*);
+void run_league(League*, int, HistoryWriter*);
+void print_league_report(const League*, int, double);
+
+bool open_history_writer(const char*, HistoryWriter*);
+uint32_t history_player_id(HistoryWriter*, const char*);
+void write_history_game(HistoryWriter*, int, const Player*);
+void close_history_writer(HistoryWriter*);
+bool open_history(const char*, History*);
+void close_history(History*);
+void print_history_stats(const History*);
+void print_high_games(const History*, int);
+void print_head_to_head(const History*, const char*, const char*);
+
+void strike_biased_model(const PinModel*, double, PinModel*);
+double likelihood_ratio(const Player*, const PinModel*, const PinModel*);
+void run_rare_events(long long, int, uint64_t, const PinModel*, double, int, int);
+void sample_series(long long, RandomStream, const PinModel*, const PinModel*, int, int, TailEstimate*);
+void add_sample(TailEstimate*, bool, double);
+void print_tail_estimate(const char*, const TailEstimate*, double);
+
+void run_lanes(int, int, int, int, uint64_t, const PinModel*);
+void lane_worker(int, int, RandomStream, vector<Lane>*, WorkQueue*, Standings*, atomic<int>*, atomic<long long>*);
+bool next_task(int, int, WorkQueue*, RandomStream*, int*, atomic<long long>*);
+void bowl_lane_frame(Lane*, Standings*);
+void update_standings(Standings*, int, int, bool);
+
 /*********************************************************************
 ** Function: main
 ** Description: Seeds the random number generator and calls game_setup
 **   and lets_go_bowling while the user chooses to keep playing. Handles
 **   memory deallocation of Player arrays created on the heap in game_setup.
-** Parameters: N/A
+**   If one of the non-interactive modes described in the file header is
+**   requested on the command line, runs it instead.
+** Parameters: int argc - the number of command-line arguments passed in.
+**             char *argv[] - array of C-style strings containing all of
+**               the command-line arguments.
 ** Pre-Conditions: N/A
-** Post-Conditions: The last game has finished and the user chose to quit.
+** Post-Conditions: The last game has finished and the user chose to quit,
+**   or the requested report has been printed.
 ** Return: 0
 *********************************************************************/
-int main() {
+int main(int argc, char *argv[]) {
+    vector<PinModel> models;
+    const char *model_path = find_option(argc, argv, "--model");
+    if (model_path && !load_pin_models(model_path, models)) {
+        cout << "Could not load pin models from " << model_path << endl;
+        return 0;
+    }
+    // The simulation and exact modes use the chosen profile, the first
+    // profile in the file, or the uniform model, in that order.
+    const char *bowler = find_option(argc, argv, "--bowler");
+    const PinModel *sim_model = (bowler ? find_pin_model(models, bowler) : (models.empty() ? 0 : &models[0]));
+    if (bowler && !sim_model) {
+        cout << "No pin model for " << bowler << endl;
+        return 0;
+    }
+
+    const char *seed_arg = find_option(argc, argv, "--seed");
+    uint64_t seed = (seed_arg ? strtoull(seed_arg, 0, 10) : time_seed());
+
+    const char *games = find_option(argc, argv, "--simulate");
+    SimStats stats;
+    double seconds = 0;
+    if (games) {
+        const char *threads = find_option(argc, argv, "--threads");
+        seconds = run_simulation(atoll(games), threads ? atoi(threads) : thread::hardware_concurrency(),
+                                 seed, sim_model, &stats);
+    }
+    if (has_flag(argc, argv, "--exact")) {
+        PinModel uniform;
+        double distribution[301];
+        uniform_pin_model(&uniform);
+        exact_distribution(sim_model ? sim_model : &uniform, distribution);
+        print_exact_report(distribution, games ? &stats : 0);
+        return 0;
+    }
+    if (games) {
+        print_simulation_report(&stats, seconds);
+        return 0;
+    }
+    const char *rare = find_option(argc, argv, "--rare");
+    if (rare) {
+        const char *threads = find_option(argc, argv, "--threads");
+        const char *bias = find_option(argc, argv, "--bias"), *tail = find_option(argc, argv, "--tail");
+        const char *series = find_option(argc, argv, "--series");
+        run_rare_events(atoll(rare), threads ? atoi(threads) : thread::hardware_concurrency(),
+                        seed, sim_model, bias ? atof(bias) : 0.85,
+                        tail ? atoi(tail) : 300, series ? atoi(series) : 800);
+        return 0;
+    }
+    const char *lanes = find_option(argc, argv, "--lanes");
+    if (lanes) {
+        const char *threads = find_option(argc, argv, "--threads");
+        const char *bowlers = find_option(argc, argv, "--bowlers"), *lane_games = find_option(argc, argv, "--games");
+        run_lanes(atoi(lanes), bowlers ? atoi(bowlers) : 4, lane_games ? atoi(lane_games) : 1,
+                  threads ? atoi(threads) : thread::hardware_concurrency(),
+                  seed, sim_model);
+        return 0;
+    }
+    const char *history_path = find_option(argc, argv, "--history");
+    const char *top = find_option(argc, argv, "--top"), *h2h = find_option(argc, argv, "--h2h");
+    if (history_path && (top || h2h || has_flag(argc, argv, "--stats"))) {
+        History history;
+        if (!open_history(history_path, &history)) {
+            cout << "Could not read game history from " << history_path << endl;
+            return 0;
+        }
+        if (has_flag(argc, argv, "--stats"))
+            print_history_stats(&history);
+        if (top)
+            print_high_games(&history, atoi(top));
+        if (h2h && find_option(argc, argv, "--vs"))
+            print_head_to_head(&history, h2h, find_option(argc, argv, "--vs"));
+        close_history(&history);
+        return 0;
+    }
+    HistoryWriter writer;
+    if (history_path && !open_history_writer(history_path, &writer)) {
+        cout << "Could not open game history " << history_path << endl;
+        return 0;
+    }
+
+    const char *league_size = find_option(argc, argv, "--league");
+    if (league_size) {
+        League league;
+        const char *names = find_option(argc, argv, "--names"), *nights = find_option(argc, argv, "--games");
+        ifstream name_file;
+        if (names)
+            name_file.open(names);
+        string name;
+        for (int i = 0; i < atoi(league_size); ++i) {
+            if (!names || !getline(name_file, name))
+                name = "Bowler " + to_string(i + 1);
+            int id = intern_name(&league, name.c_str());
+            league.model[id] = find_pin_model(models, name.c_str());
+        }
+        if (nights && atoi(nights) < 1) {
+            cout << "Please pass a positive number of games to --games." << endl;
+            close_history_writer(&writer);
+            return 0;
+        }
+        pin_rng = make_stream(seed);
+        run_league(&league, nights ? atoi(nights) : 1, history_path ? &writer : 0);
+        close_history_writer(&writer);
+        return 0;
+    }
+    const char *score_path = find_option(argc, argv, "--score");
+    if (score_path) {
+        score_file(score_path);
+        return 0;
+    }
+
     int number_players;
     Player *player_list = 0;
-    srand(time(NULL));
+    pin_rng = make_stream(seed);
 
     do {
         number_players = game_setup(&player_list);
+        for (int i = 0; i < number_players; ++i)
+            player_list[i].model = find_pin_model(models, player_list[i].name);
         lets_go_bowling(number_players, player_list);
+        if (history_path)
+            write_history_game(&writer, number_players, player_list);
         delete[] player_list;
         player_list = 0;
     }while (2 != get_integer("Would you like to play again (1: Yes, 2: Quit)? ", 2));
+    close_history_writer(&writer);
 
     return 0;
 }
@@ -132,10 +533,13 @@ int get_integer(const string &prompt, int max_input) {
 ** Return: N/A
 *********************************************************************/
 void lets_go_bowling(int num_p, Player *p) {
+    Scoreboard board;
+    init_scoreboard(&board, num_p, p);
     for (int frame = 0; frame <= FINAL_FRAME; ++frame)
         for (int bowler = 0; bowler < num_p; ++bowler) {
-            bowl_frame(frame, &p[bowler], num_p, p);
+            bowl_frame(frame, &p[bowler], &board);
         }
+    close_scoreboard(&board);
     declare_winner(num_p, p);
 }
 
@@ -147,8 +551,8 @@ void lets_go_bowling(int num_p, Player *p) {
 **   spare was bowled.
 ** Parameters: int frame - the current frame number.
 **             Player *bowler - the player currently bowling.
-**             int num_p - the number of players.
-**             Player *p_list - pointer to the Player array on the heap.
+**             Scoreboard *board - the scoreboard to update after each
+**               ball, or a null pointer to bowl silently.
 ** Pre-Conditions: N/A
 ** Post-Conditions: The Player object's bowls[], frame_s[], and total_s
 **   member variables have been updated to reflect the bowling outcomes
@@ -156,20 +560,21 @@ void lets_go_bowling(int num_p, Player *p) {
 **   or spare frames.
 ** Return: N/A
 *********************************************************************/
-void bowl_frame(int frame, Player *bowler, int num_p, Player *p_list) {
+void bowl_frame(int frame, Player *bowler, Scoreboard *board) {
     int pins_left = 10;
-    int pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * frame]), pins_left, true);
+    const char *name = (board ? bowler->name : 0);
+    int pins_knocked_down = bowl(name, &(bowler->bowls[2 * frame]), pins_left, true, bowler->model);
     update_score(frame, bowler, pins_knocked_down, 1);
-    print_scoreboard(num_p, p_list);
+    print_scoreboard(board);
     pins_left -= pins_knocked_down;
     if (pins_left) {
-        pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * frame + 1]), pins_left, false);
+        pins_knocked_down = bowl(name, &(bowler->bowls[2 * frame + 1]), pins_left, false, bowler->model);
         update_score(frame, bowler, pins_knocked_down, 2);
-        print_scoreboard(num_p, p_list);
+        print_scoreboard(board);
     }
     if (frame == FINAL_FRAME && bowler->frame_s[frame] == 10) {
         bool strike = (bowler->bowls[2 * frame] == 'X');
-        fill_balls(bowler, strike, num_p, p_list);
+        fill_balls(bowler, strike, board);
     }
 }
 
@@ -191,25 +596,44 @@ void bowl_frame(int frame, Player *bowler, int num_p, Player *p_list) {
 ** Return: N/A
 *********************************************************************/
 void update_score(int frame, Player *bowler, int pins_knocked_down, int ball_number) {
-    bowler->frame_s[frame] += pins_knocked_down;
-    bowler->total_s += pins_knocked_down;
+    score_ball(frame, bowler->bowls, bowler->frame_s, &bowler->total_s, pins_knocked_down, ball_number);
+}
+
+/*********************************************************************
+** Function: score_ball
+** Description: The scoring rules of update_score, applied to a game
+**   stored anywhere: in a Player or in a League's columns.
+** Parameters: int frame - the current frame number.
+**             const char *bowls - the game's 21 bowl characters.
+**             int *frame_s - the game's 10 frame scores.
+**             int *total_s - the game's total score.
+**             int pins_knocked_down - how many pins were knocked down.
+**             int ball_number - 1, 2, or 3, as for update_score.
+** Pre-Conditions: As for update_score.
+** Post-Conditions: frame_s[] and *total_s have been updated based on
+**   pins_knocked_down and ball_number.
+** Return: N/A
+*********************************************************************/
+void score_ball(int frame, const char *bowls, int *frame_s, int *total_s, int pins_knocked_down, int ball_number) {
+    frame_s[frame] += pins_knocked_down;
+    *total_s += pins_knocked_down;
 
     if (!frame)
         return;
 
     if (ball_number == 1) {
-        if (bowler->frame_s[frame - 1] == 10) {
-            bowler->frame_s[frame - 1] += pins_knocked_down;
-            bowler->total_s += pins_knocked_down;
+        if (frame_s[frame - 1] == 10) {
+            frame_s[frame - 1] += pins_knocked_down;
+            *total_s += pins_knocked_down;
         }
-        if (frame > 1 && bowler->bowls[2 * (frame - 1)] == 'X' && bowler->bowls[2 * (frame - 2)] == 'X') {
-            bowler->frame_s[frame - 2] += pins_knocked_down;
-            bowler->total_s += pins_knocked_down;
+        if (frame > 1 && bowls[2 * (frame - 1)] == 'X' && bowls[2 * (frame - 2)] == 'X') {
+            frame_s[frame - 2] += pins_knocked_down;
+            *total_s += pins_knocked_down;
         }
     }
-    else if (ball_number == 2 && bowler->bowls[2 * (frame - 1)] == 'X') {
-        bowler->frame_s[frame - 1] += pins_knocked_down;
-        bowler->total_s += pins_knocked_down;
+    else if (ball_number == 2 && bowls[2 * (frame - 1)] == 'X') {
+        frame_s[frame - 1] += pins_knocked_down;
+        *total_s += pins_knocked_down;
     }
 }
 
@@ -218,40 +642,43 @@ void update_score(int frame, Player *bowler, int pins_knocked_down, int ball_num
 ** Description: Prompts bowler, generates random bowl result, outputs
 **   a message notifying the player of the result, and stores the result
 **   in the player's bowls[] member variable char array, but does not
-**   update frame or total scores.
-** Parameters: const char *name - the bowler's name.
+**   update frame or total scores. If name is a null pointer, the bowl
+**   is silent (no prompt and no message).
+** Parameters: const char *name - the bowler's name, or a null pointer.
 **             char* scorecard - where the result char should be stored.
 **             int pins_left - the maximum number of pins that can be
 **               knocked down.
 **             bool new_frame - whether this is the first bowl of the
 **               frame.
+**             const PinModel *model - the bowler's pin model, or a null
+**               pointer for the uniform model (the default).
 ** Pre-Conditions: pins_left is from 1 to 10.
 ** Post-Conditions: The result of the bowl has been output to the console
 **   and stored in the char pointed to by scorecard.
 ** Return: The number of pins knocked down, between 0 and pins_left.
 *********************************************************************/
-int bowl(const char *name, char *scorecard, int pins_left, bool new_frame) {
-    prompt_bowler(name);
-    int pins_knocked_down = rand() % (pins_left + 1);
+int bowl(const char *name, char *scorecard, int pins_left, bool new_frame, const PinModel *model) {
+    if (name)
+        prompt_bowler(name);
+    int pins_knocked_down = (model ? sample_pins(model, pins_left, new_frame)
+                                   : random_below(&pin_rng, pins_left + 1));
 
-    if (pins_knocked_down == pins_left) {
-        if (new_frame) {
-            *scorecard = 'X';
-            cout << "You bowled a strike! Congratulations!\n\n";
-        }
-        else {
-            *scorecard = '/';
-            cout << "You bowled a spare! Good job!\n\n";
-        }
-    }
-    else if (!pins_knocked_down) {
+    if (pins_knocked_down == pins_left)
+        *scorecard = (new_frame ? 'X' : '/');
+    else if (!pins_knocked_down)
         *scorecard = '-';
+    else *scorecard = pins_knocked_down + '0';
+
+    if (!name)
+        return pins_knocked_down;
+
+    if (*scorecard == 'X')
+        cout << "You bowled a strike! Congratulations!\n\n";
+    else if (*scorecard == '/')
+        cout << "You bowled a spare! Good job!\n\n";
+    else if (*scorecard == '-')
         cout << "You bowled a gutter ball... This isn't bumper bowling!\n\n";
-    }
-    else {
-        *scorecard = pins_knocked_down + '0';
-        cout << "You knocked down " << pins_knocked_down << " pins.\n\n";
-    }
+    else cout << "You knocked down " << pins_knocked_down << " pins.\n\n";
     return pins_knocked_down;
 }
 
@@ -262,30 +689,31 @@ int bowl(const char *name, char *scorecard, int pins_left, bool new_frame) {
 ** Parameters: Player *p - the player currently bowling.
 **             bool strike - whether the player scored a strike (true)
 **               or a spare (false) in the final frame.
-**             int num_p - the number of players.
-**             Player *p_list - pointer to the Player array on the heap.
+**             Scoreboard *board - the scoreboard to update after each
+**               ball, or a null pointer to bowl silently.
 ** Pre-Conditions: N/A
 ** Post-Conditions: The frame_s[] and total_s member objects have been
 **   updated based on the fill ball result(s).
 ** Return: N/A
 *********************************************************************/
-void fill_balls(Player *bowler, bool strike, int num_p, Player *p_list) {
+void fill_balls(Player *bowler, bool strike, Scoreboard *board) {
     int pins_left = 10, pins_knocked_down;
+    const char *name = (board ? bowler->name : 0);
     if (strike) {
-        pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * FINAL_FRAME + 1]), pins_left, true);
+        pins_knocked_down = bowl(name, &(bowler->bowls[2 * FINAL_FRAME + 1]), pins_left, true, bowler->model);
         update_score(FINAL_FRAME, bowler, pins_knocked_down, 2);
-        print_scoreboard(num_p, p_list);
+        print_scoreboard(board);
         pins_left -= pins_knocked_down;
         if (pins_left)
-            pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * FINAL_FRAME + 2]), pins_left, false);
-        else pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * FINAL_FRAME + 2]), 10, true);
+            pins_knocked_down = bowl(name, &(bowler->bowls[2 * FINAL_FRAME + 2]), pins_left, false, bowler->model);
+        else pins_knocked_down = bowl(name, &(bowler->bowls[2 * FINAL_FRAME + 2]), 10, true, bowler->model);
         update_score(FINAL_FRAME, bowler, pins_knocked_down, 3);
     }
     else {
-        pins_knocked_down = bowl(bowler->name, &(bowler->bowls[2 * FINAL_FRAME + 2]), pins_left, true);
+        pins_knocked_down = bowl(name, &(bowler->bowls[2 * FINAL_FRAME + 2]), pins_left, true, bowler->model);
         update_score(FINAL_FRAME, bowler, pins_knocked_down, 3);
     }
-    print_scoreboard(num_p, p_list);
+    print_scoreboard(board);
 }
 
 /*********************************************************************
@@ -304,123 +732,196 @@ void prompt_bowler(const char *name) {
 }
 
 /*********************************************************************
-** Function: print_scoreboard
-** Description: Prints the scoreboard to the console, displaying the
-**   results of each bowl thus far, as well as current frame scores and
-**   total score of all players.
-** Parameters: int num_p - the number of players.
+** Function: init_scoreboard
+** Description: Prepares a scoreboard for a game, allocating its buffers
+**   once up front. On a terminal the board is later pinned to the top
+**   of the screen, with prompts and messages scrolling underneath it;
+**   otherwise it is printed in full after every ball.
+** Parameters: Scoreboard *board - the scoreboard to set up.
+**             int num_p - the number of players.
 **             Player *p_list - pointer to the Player array on the heap.
-** Pre-Conditions: name points to an initialized char or C-style string.
-** Post-Conditions: N/A
+** Pre-Conditions: p_list points to a Player array of length num_p.
+** Post-Conditions: board is ready for print_scoreboard.
 ** Return: N/A
 *********************************************************************/
-void print_scoreboard(int num_p, Player *p_list) {
-    Player *curr_p;
-    cout << "Name          |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |   10  | Total";
-    for (int p = 0; p < num_p; ++p) {
-        curr_p = &p_list[p];
-        cout << '\n' << setw(84) << setfill('-') << '\n';
-        cout << curr_p->name;
-        spaces(14 - strlen(curr_p->name));
-        print_bowls(curr_p);
-        print_scores(curr_p);
-    }
-    cout << endl;
+void init_scoreboard(Scoreboard *board, int num_p, Player *p_list) {
+    board->num_p = num_p;
+    board->p_list = p_list;
+    board->rows = 1 + 3 * num_p;
+    board->shown.assign(board->rows * BOARD_WIDTH, ' ');
+    board->next.assign(board->rows * BOARD_WIDTH, ' ');
+    board->out.reserve(2 * board->rows * (BOARD_WIDTH + 16) + 64);
+
+    // Only pin the board if it leaves room for messages below it.
+    winsize size;
+    board->tty = isatty(STDOUT_FILENO) && !ioctl(STDOUT_FILENO, TIOCGWINSZ, &size)
+                 && size.ws_row > board->rows + 4;
+    board->drawn = false;
+
+    const char header[] = "Name          |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |   10  | Total";
+    memcpy(&board->next[0], header, sizeof(header) - 1);
+    for (int p = 0; p < num_p; ++p)
+        memset(&board->next[(1 + 3 * p) * BOARD_WIDTH], '-', BOARD_WIDTH - 1);
 }
 
 /*********************************************************************
-** Function: spaces
-** Description: Outputs num_spaces ' ' characters to the console.
-** Parameters: int num_spaces - the number of spaces to be output.
-** Pre-Conditions: num_spaces must be non-negative.
-** Post-Conditions: num_spaces ' ' characters have been output to the
-**   console.
+** Function: print_scoreboard
+** Description: Renders the scoreboard into the off-screen buffer and
+**   updates the console, displaying the results of each bowl thus far,
+**   as well as current frame scores and total score of all players.
+**   On a terminal, the first call clears the screen and pins the board
+**   to the top; later calls rewrite only the changed cells, moving the
+**   cursor to each run of changes. Everything is sent with one write.
+** Parameters: Scoreboard *board - the scoreboard, or a null pointer, in
+**               which case nothing is printed.
+** Pre-Conditions: board was set up by init_scoreboard.
+** Post-Conditions: The console shows the current scores.
 ** Return: N/A
 *********************************************************************/
-void spaces(int num_spaces) {
-    for (int i = 0; i < num_spaces; ++i)
-        cout << ' ';
+void print_scoreboard(Scoreboard *board) {
+    if (!board)
+        return;
+    for (int p = 0; p < board->num_p; ++p)
+        render_player(&board->next[(2 + 3 * p) * BOARD_WIDTH], &board->p_list[p]);
+
+    string &out = board->out;
+    out.clear();
+    if (!board->tty) {
+        for (int r = 0; r < board->rows; ++r) {
+            const char *row = &board->next[r * BOARD_WIDTH];
+            int len = BOARD_WIDTH;
+            while (len && row[len - 1] == ' ')
+                --len;
+            out.append(row, len);
+            out += '\n';
+        }
+    }
+    else if (!board->drawn) {
+        out += "\x1b[2J\x1b[H";
+        for (int r = 0; r < board->rows; ++r) {
+            out.append(&board->next[r * BOARD_WIDTH], BOARD_WIDTH - 1);
+            out += "\r\n";
+        }
+        // Messages scroll in the region below the board.
+        out += "\x1b[" + to_string(board->rows + 2) + "r\x1b[" + to_string(board->rows + 2) + ";1H";
+        board->drawn = true;
+    }
+    else {
+        out += "\x1b" "7";
+        for (int r = 0; r < board->rows; ++r) {
+            const char *now = &board->next[r * BOARD_WIDTH], *was = &board->shown[r * BOARD_WIDTH];
+            for (int col = 0; col < BOARD_WIDTH; ++col) {
+                if (now[col] == was[col])
+                    continue;
+                // Extend the run over short unchanged gaps, which are
+                // cheaper to resend than another cursor move.
+                int end = col + 1, same = 0;
+                while (end + same < BOARD_WIDTH && same < 8) {
+                    if (now[end + same] != was[end + same]) {
+                        end += same + 1;
+                        same = 0;
+                    }
+                    else ++same;
+                }
+                out += "\x1b[" + to_string(r + 1) + ';' + to_string(col + 1) + 'H';
+                out.append(now + col, end - col);
+                col = end;
+            }
+        }
+        out += "\x1b" "8";
+    }
+    board->shown = board->next;
+
+    cout.flush();
+    fflush(stdout);
+    for (size_t done = 0; done < out.size(); ) {
+        ssize_t n = write(STDOUT_FILENO, out.data() + done, out.size() - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
 }
 
 /*********************************************************************
-** Function: space_if_zero
-** Description: Returns a ' ' is the passed character is equal to 0, and
-**   returns the character otherwise.
-** Parameters: char c - the character to be checked.
-** Pre-Conditions: N/A
-** Post-Conditions: N/A
-** Return: A space or the passed character.
+** Function: close_scoreboard
+** Description: Releases the pinned region of the screen at the end of a
+**   game so that later output scrolls normally.
+** Parameters: Scoreboard *board - the scoreboard.
+** Pre-Conditions: board was set up by init_scoreboard.
+** Post-Conditions: The terminal scrolls the whole screen again.
+** Return: N/A
 *********************************************************************/
-char space_if_zero(char c) {
-    return (c ? c : ' ');
+void close_scoreboard(Scoreboard *board) {
+    if (board->tty && board->drawn) {
+        cout << "\x1b" "7\x1b[r\x1b" "8" << flush;
+        board->drawn = false;
+    }
 }
 
 /*********************************************************************
-** Function: print_bowls
-** Description: Prints the bowling results.
-** Parameters: Player *curr_p - the player whose results are being
-**               printed.
-** Pre-Conditions: N/A
-** Post-Conditions: The bowling results have been printed to the console.
+** Function: render_player
+** Description: Writes one player's two scoreboard rows (bowl results
+**   with the total, then frame scores) into the off-screen buffer.
+**   Scores are right-aligned in their cells.
+** Parameters: char *rows - the start of the player's bowl row; the
+**               frame score row follows BOARD_WIDTH characters later.
+**             const Player *curr_p - the player being rendered.
+** Pre-Conditions: rows has room for two rows of BOARD_WIDTH characters.
+** Post-Conditions: Both rows hold the player's current results.
 ** Return: N/A
 *********************************************************************/
-void print_bowls(Player *curr_p) {
-    cout << "| ";
+void render_player(char *rows, const Player *curr_p) {
+    char *bowls = rows, *scores = rows + BOARD_WIDTH;
+    memset(rows, ' ', 2 * BOARD_WIDTH);
+
+    int len = min((int)strlen(curr_p->name), 14);
+    memcpy(bowls, curr_p->name, len);
     for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
-        cout << space_if_zero(curr_p->bowls[2 * frame]) << ' ' << space_if_zero(curr_p->bowls[2 * frame + 1]);
-        if (frame == FINAL_FRAME)
-            cout << ' ' << space_if_zero(curr_p->bowls[2 * frame + 2]);
-        cout << " | ";
+        int col = 14 + 6 * frame;
+        bowls[col] = '|';
+        bowls[col + 2] = space_if_zero(curr_p->bowls[2 * frame]);
+        bowls[col + 4] = space_if_zero(curr_p->bowls[2 * frame + 1]);
+        scores[col] = '|';
+        if (frame == FINAL_FRAME) {
+            bowls[col + 6] = space_if_zero(curr_p->bowls[2 * frame + 2]);
+            bowls[col + 8] = '|';
+            scores[col + 8] = '|';
+        }
+        if (curr_p->frame_s[frame] || curr_p->bowls[2 * frame])
+            put_score(scores, col + (frame == FINAL_FRAME ? 6 : 4), curr_p->frame_s[frame]);
     }
+    put_score(bowls, 82, curr_p->total_s);
 }
 
 /*********************************************************************
-** Function: print_scores
-** Description: Prints the frame scores and total scores.
-** Parameters: Player *curr_p - the player whose scores are being
-**               printed.
+** Function: space_if_zero
+** Description: Returns a ' ' is the passed character is equal to 0, and
+**   returns the character otherwise.
+** Parameters: char c - the character to be checked.
 ** Pre-Conditions: N/A
-** Post-Conditions: The scores have been printed to the console.
-** Return: N/A
+** Post-Conditions: N/A
+** Return: A space or the passed character.
 *********************************************************************/
-void print_scores(Player *curr_p) {
-    spaces(4);
-    format_score(curr_p->total_s);
-    cout << endl;
-    spaces(14);
-    cout << "|   ";
-    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
-        if (frame == FINAL_FRAME)
-            spaces(2);
-        format_score(curr_p->frame_s[frame], curr_p->bowls[2 * frame]);
-        cout << " |   ";
-    }
+char space_if_zero(char c) {
+    return (c ? c : ' ');
 }
 
 /*********************************************************************
-** Function: format_score
-** Description: Prints the score if score and bowl are not both
-**   zero, otherwise prints a space. If the score is 10 or greater,
-**   the most recent character printed to the console will be erased.
-**   If the score is 100 or greater, a second character will also be
-**   erased.
-** Parameters: int score - the score to be output.
-**             char bowl - the result of the first bowl of the frame,
-**               default value is 1.
-** Pre-Conditions: score is non-negative.
-** Post-Conditions: The score has been output to the console properly.
+** Function: put_score
+** Description: Writes a score into a row so that its last digit lands
+**   in the given column.
+** Parameters: char *row - the row being rendered.
+**             int last_col - the column of the last digit.
+**             int score - the non-negative score to write.
+** Pre-Conditions: last_col is at least 2.
+** Post-Conditions: The digits of score end at row[last_col].
 ** Return: N/A
 *********************************************************************/
-void format_score(int score, char bowl) {
-    if (!score && !bowl)
-        cout << ' ';
-    else {
-        if (score >= 10)
-            cout << '\b';
-        if (score >= 100)
-            cout << '\b';
-        cout << score;
-    }
+void put_score(char *row, int last_col, int score) {
+    do {
+        row[last_col--] = '0' + score % 10;
+        score /= 10;
+    }while (score);
 }
 
 /*********************************************************************
@@ -452,3 +953,1598 @@ void declare_winner(int num_p, Player *p_list) {
         cout << "\nIt was a tie!" << endl;
     else cout << '\n' << winner << " won the game!" << endl;
 }
+
+
+/*********************************************************************
+** Function: find_option
+** Description: Searches the command-line arguments for a flag and
+**   returns the argument that immediately follows it.
+** Parameters: int argc - the number of command-line arguments.
+**             char *argv[] - the command-line arguments.
+**             const char *flag - the flag to search for, e.g. "--seed".
+** Pre-Conditions: argv holds argc C-style strings.
+** Post-Conditions: N/A
+** Return: The argument following flag, or a null pointer if the flag
+**   was not passed or has no value after it.
+*********************************************************************/
+const char* find_option(int argc, char *argv[], const char *flag) {
+    for (int i = 1; i < argc - 1; ++i)
+        if (!strcmp(argv[i], flag))
+            return argv[i + 1];
+    return 0;
+}
+
+/*********************************************************************
+** Function: has_flag
+** Description: Checks whether a flag was passed on the command line.
+** Parameters: int argc - the number of command-line arguments.
+**             char *argv[] - the command-line arguments.
+**             const char *flag - the flag to search for, e.g. "--exact".
+** Pre-Conditions: argv holds argc C-style strings.
+** Post-Conditions: N/A
+** Return: True if the flag was passed, false otherwise.
+*********************************************************************/
+bool has_flag(int argc, char *argv[], const char *flag) {
+    for (int i = 1; i < argc; ++i)
+        if (!strcmp(argv[i], flag))
+            return true;
+    return false;
+}
+
+/*********************************************************************
+** Function: run_simulation
+** Description: Splits the requested number of games across worker
+**   threads, runs them headlessly, and merges the per-thread statistics.
+** Parameters: long long games - the total number of games to simulate.
+**             int threads - the number of worker threads to use.
+**             uint64_t seed - the run's seed; thread i bowls with stream
+**               i of it.
+**             const PinModel *model - the pin model to bowl with, or a
+**               null pointer for the uniform model.
+**             SimStats *total - where the merged statistics are stored.
+** Pre-Conditions: total points to a zero-initialized SimStats object.
+** Post-Conditions: total holds the results of every simulated game.
+** Return: The wall-clock time the games took, in seconds.
+*********************************************************************/
+double run_simulation(long long games, int threads, uint64_t seed, const PinModel *model, SimStats *total) {
+    if (games < 1)
+        games = 1;
+    if (threads < 1)
+        threads = 1;
+    if (threads > games)
+        threads = games;
+
+    vector<SimStats> stats(threads);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i) {
+        long long share = games / threads + (i < games % threads);
+        workers.push_back(thread(simulate_games, share, make_stream(seed, i), model, &stats[i]));
+    }
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    for (int i = 0; i < threads; ++i)
+        merge_stats(total, &stats[i]);
+    return elapsed.count();
+}
+
+/*********************************************************************
+** Function: simulate_games
+** Description: Thread body for run_simulation. Installs this thread's
+**   random stream and plays the requested number of single-player games
+**   without any console input or output.
+** Parameters: long long games - how many games this thread plays.
+**             RandomStream stream - this thread's random stream.
+**             const PinModel *model - the pin model to bowl with, or a
+**               null pointer for the uniform model.
+**             SimStats *stats - where this thread's results are stored.
+** Pre-Conditions: stats points to a zero-initialized SimStats object
+**   that no other thread writes to.
+** Post-Conditions: stats holds the results of all games played.
+** Return: N/A
+*********************************************************************/
+void simulate_games(long long games, RandomStream stream, const PinModel *model, SimStats *stats) {
+    pin_rng = stream;
+    for (long long g = 0; g < games; ++g) {
+        Player bowler;
+        bowler.model = model;
+        simulate_game(&bowler);
+        record_game(&bowler, stats);
+    }
+}
+
+/*********************************************************************
+** Function: simulate_game
+** Description: Plays one full 10-frame game for a single player using
+**   the same bowl_frame, update_score, and fill_balls rules as an
+**   interactive game, but without prompting or printing.
+** Parameters: Player *bowler - the player bowling the game.
+** Pre-Conditions: bowler points to a freshly constructed Player.
+** Post-Conditions: bowler's bowls[], frame_s[], and total_s hold the
+**   results of a complete game.
+** Return: N/A
+*********************************************************************/
+void simulate_game(Player *bowler) {
+    simulate_columns(bowler->bowls, bowler->frame_s, &bowler->total_s, bowler->model);
+}
+
+/*********************************************************************
+** Function: simulate_columns
+** Description: Plays one full 10-frame game silently with the rules of
+**   bowl_frame and fill_balls, writing the results wherever the caller
+**   keeps them, so that league play can bowl straight into its columns.
+** Parameters: char *bowls - receives the game's 21 bowl characters.
+**             int *frame_s - receives the game's 10 frame scores.
+**             int *total_s - receives the game's total score.
+**             const PinModel *model - the bowler's pin model, or a null
+**               pointer for the uniform model.
+** Pre-Conditions: bowls, frame_s, and *total_s are all zero.
+** Post-Conditions: They hold the results of a complete game.
+** Return: N/A
+*********************************************************************/
+void simulate_columns(char *bowls, int *frame_s, int *total_s, const PinModel *model) {
+    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+        int pins_knocked_down = bowl(0, &bowls[2 * frame], 10, true, model);
+        score_ball(frame, bowls, frame_s, total_s, pins_knocked_down, 1);
+        if (pins_knocked_down < 10) {
+            pins_knocked_down = bowl(0, &bowls[2 * frame + 1], 10 - pins_knocked_down, false, model);
+            score_ball(frame, bowls, frame_s, total_s, pins_knocked_down, 2);
+        }
+    }
+    if (frame_s[FINAL_FRAME] != 10)
+        return;
+    if (bowls[2 * FINAL_FRAME] == 'X') {
+        int pins_knocked_down = bowl(0, &bowls[2 * FINAL_FRAME + 1], 10, true, model);
+        score_ball(FINAL_FRAME, bowls, frame_s, total_s, pins_knocked_down, 2);
+        if (pins_knocked_down < 10)
+            pins_knocked_down = bowl(0, &bowls[2 * FINAL_FRAME + 2], 10 - pins_knocked_down, false, model);
+        else pins_knocked_down = bowl(0, &bowls[2 * FINAL_FRAME + 2], 10, true, model);
+        score_ball(FINAL_FRAME, bowls, frame_s, total_s, pins_knocked_down, 3);
+    }
+    else {
+        int pins_knocked_down = bowl(0, &bowls[2 * FINAL_FRAME + 2], 10, true, model);
+        score_ball(FINAL_FRAME, bowls, frame_s, total_s, pins_knocked_down, 3);
+    }
+}
+
+/*********************************************************************
+** Function: record_game
+** Description: Adds a completed game to the running statistics. Strike
+**   and spare rates only count the ten regular frames, not fill balls.
+** Parameters: const Player *bowler - the player who bowled the game.
+**             SimStats *stats - the statistics to be updated.
+** Pre-Conditions: bowler holds a complete game.
+** Post-Conditions: stats has been updated with the game's results.
+** Return: N/A
+*********************************************************************/
+void record_game(const Player *bowler, SimStats *stats) {
+    ++stats->games;
+    ++stats->histogram[bowler->total_s];
+    stats->total_pins += bowler->total_s;
+    if (bowler->total_s > stats->high_game)
+        stats->high_game = bowler->total_s;
+    if (bowler->total_s < stats->low_game)
+        stats->low_game = bowler->total_s;
+
+    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+        if (bowler->bowls[2 * frame] == 'X')
+            ++stats->strikes;
+        else {
+            ++stats->spare_chances;
+            if (bowler->bowls[2 * frame + 1] == '/')
+                ++stats->spares;
+        }
+    }
+}
+
+/*********************************************************************
+** Function: merge_stats
+** Description: Adds the results held in one SimStats object to another.
+** Parameters: SimStats *total - the statistics to be added to.
+**             const SimStats *part - the statistics to add.
+** Pre-Conditions: N/A
+** Post-Conditions: total holds the combined results of both objects.
+** Return: N/A
+*********************************************************************/
+void merge_stats(SimStats *total, const SimStats *part) {
+    total->games += part->games;
+    for (int i = 0; i <= 300; ++i)
+        total->histogram[i] += part->histogram[i];
+    total->strikes += part->strikes;
+    total->spares += part->spares;
+    total->spare_chances += part->spare_chances;
+    total->total_pins += part->total_pins;
+    if (part->high_game > total->high_game)
+        total->high_game = part->high_game;
+    if (part->low_game < total->low_game)
+        total->low_game = part->low_game;
+}
+
+/*********************************************************************
+** Function: print_simulation_report
+** Description: Prints the score histogram (in buckets of ten pins),
+**   summary statistics, strike and spare rates, and throughput.
+** Parameters: const SimStats *stats - the merged simulation results.
+**             double seconds - the wall-clock time the games took.
+** Pre-Conditions: stats->games is positive.
+** Post-Conditions: The report has been printed to the console.
+** Return: N/A
+*********************************************************************/
+void print_simulation_report(const SimStats *stats, double seconds) {
+    double mean = (double)stats->total_pins / stats->games, variance = 0;
+    for (int i = 0; i <= 300; ++i)
+        variance += stats->histogram[i] * (i - mean) * (i - mean);
+    variance /= stats->games;
+
+    cout << "Score    Games          Percent\n";
+    for (int bucket = 0; bucket <= 300; bucket += 10) {
+        long long count = 0;
+        for (int i = bucket; i < bucket + 10 && i <= 300; ++i)
+            count += stats->histogram[i];
+        if (!count)
+            continue;
+        cout << setfill(' ') << setw(3) << bucket << '-' << setw(3) << (bucket == 300 ? 300 : bucket + 9) << "  "
+             << setw(12) << count << "  " << fixed << setprecision(6) << setw(10)
+             << 100.0 * count / stats->games << "%\n";
+    }
+    cout << "\nGames simulated: " << stats->games
+         << "\nMean score: " << setprecision(3) << mean << " (std. dev. " << sqrt(variance) << ')'
+         << "\nLow / high game: " << stats->low_game << " / " << stats->high_game
+         << "\nPerfect games: " << stats->histogram[300]
+         << "\nStrike rate: " << 100.0 * stats->strikes / (10 * stats->games) << '%'
+         << "\nSpare rate: " << 100.0 * stats->spares / (stats->spare_chances ? stats->spare_chances : 1) << '%'
+         << "\nThroughput: " << setprecision(0) << stats->games / (seconds > 0 ? seconds : 1e-9) << " games/s" << endl;
+}
+
+/*********************************************************************
+** Function: score_file
+** Description: Streams recorded games from a file, one game per line,
+**   and prints each game's ten frame scores followed by its total.
+**   Malformed lines are reported on stderr and skipped. A summary with
+**   throughput is printed to stderr at the end.
+** Parameters: const char *path - the file to read, or "-" for stdin.
+** Pre-Conditions: N/A
+** Post-Conditions: Every line of the file has been scored or reported.
+** Return: N/A
+*********************************************************************/
+void score_file(const char *path) {
+    FILE *in = (strcmp(path, "-") ? fopen(path, "rb") : stdin);
+    if (!in) {
+        cerr << "Could not open " << path << endl;
+        return;
+    }
+    vector<char> in_buf(SCORE_BUFFER_SIZE), out_buf(SCORE_BUFFER_SIZE);
+    char *out = &out_buf[0], *out_end = out + SCORE_BUFFER_SIZE - 64;
+    long long line_number = 0, scored = 0, malformed = 0;
+    int pins[21];
+    size_t carry = 0, got;
+    Player game;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    do {
+        got = fread(&in_buf[carry], 1, in_buf.size() - carry, in);
+        size_t avail = carry + got, line_start = 0;
+        for (size_t i = 0; i < avail; ++i) {
+            if (in_buf[i] != '\n' && (got || i != avail - 1))
+                continue;
+            // Reached the end of a line (or the last, unterminated one).
+            size_t line_end = (in_buf[i] == '\n' ? i : i + 1);
+            ++line_number;
+            const char *error = parse_game(&in_buf[line_start], &in_buf[line_end], pins);
+            if (error) {
+                if (error[0]) {
+                    ++malformed;
+                    cerr << "Line " << line_number << ": " << error << endl;
+                }
+            }
+            else {
+                score_balls(pins, &game);
+                for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+                    out = append_int(out, game.frame_s[frame]);
+                    *out++ = ' ';
+                }
+                out = append_int(out, game.total_s);
+                *out++ = '\n';
+                ++scored;
+                if (out >= out_end) {
+                    fwrite(&out_buf[0], 1, out - &out_buf[0], stdout);
+                    out = &out_buf[0];
+                }
+            }
+            line_start = i + 1;
+        }
+        // Keep the partial last line for the next read, growing the
+        // buffer if a single line fills it.
+        carry = (line_start < avail ? avail - line_start : 0);
+        if (carry)
+            memmove(&in_buf[0], &in_buf[line_start], carry);
+        if (carry == in_buf.size())
+            in_buf.resize(2 * in_buf.size());
+    }while (got);
+
+    fwrite(&out_buf[0], 1, out - &out_buf[0], stdout);
+    fflush(stdout);
+    if (in != stdin)
+        fclose(in);
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cerr << "Scored " << scored << " games, " << malformed << " malformed lines, "
+         << fixed << setprecision(0) << scored / (elapsed.count() > 0 ? elapsed.count() : 1e-9)
+         << " games/s" << endl;
+}
+
+/*********************************************************************
+** Function: parse_game
+** Description: Converts one line of scoreboard notation into the number
+**   of pins knocked down by each ball, checking that the balls form a
+**   legal 10-frame game. Whitespace and a trailing '\r' are ignored.
+** Parameters: const char *begin - the first character of the line.
+**             const char *end - one past the last character of the line.
+**             int *pins - an array of at least 21 ints that will hold
+**               the pins knocked down by each ball, in order.
+** Pre-Conditions: begin and end delimit a range of characters.
+** Post-Conditions: If the game is legal, pins holds its balls.
+** Return: A null pointer if the game is legal, an empty string if the
+**   line is blank, and a description of the problem otherwise.
+*********************************************************************/
+const char* parse_game(const char *begin, const char *end, int *pins) {
+    int balls = 0, frame = 0, ball_in_frame = 0, pins_left = 10;
+    bool fresh_rack = true;
+    for (const char *c = begin; c < end; ++c) {
+        int value = BALL_VALUE[(unsigned char)*c];
+        if (value == SKIP)
+            continue;
+        if (value == INVALID)
+            return "unexpected character";
+        if (frame > FINAL_FRAME)
+            return "too many balls";
+
+        if (value == SPARE) {
+            if (fresh_rack)
+                return "spare on a fresh rack";
+            value = pins_left;
+        }
+        else if (value > pins_left)
+            return "more pins than are standing";
+        else if (value == pins_left && !fresh_rack)
+            return "spare should be written as '/'";
+
+        pins[balls++] = value;
+        pins_left -= value;
+        fresh_rack = false;
+        ++ball_in_frame;
+        if (frame != FINAL_FRAME) {
+            if (!pins_left || ball_in_frame == 2) {
+                ++frame;
+                ball_in_frame = 0;
+                pins_left = 10;
+                fresh_rack = true;
+            }
+        }
+        else {
+            if (!pins_left) {
+                pins_left = 10;
+                fresh_rack = true;
+            }
+            // The final frame ends after two balls unless they knocked
+            // down all ten pins between them.
+            if (ball_in_frame == 3 || (ball_in_frame == 2 && pins[balls - 2] + pins[balls - 1] < 10))
+                ++frame;
+        }
+    }
+    if (!balls)
+        return "";
+    if (frame <= FINAL_FRAME)
+        return "incomplete game";
+    // score_balls may look past the last ball of an open final frame.
+    while (balls < 21)
+        pins[balls++] = 0;
+    return 0;
+}
+
+/*********************************************************************
+** Function: score_balls
+** Description: Computes frame and total scores from a legal sequence of
+**   balls with the same semantics as update_score, using arithmetic on
+**   the strike and spare flags rather than branching on each ball.
+** Parameters: const int *pins - the balls of a legal game, as produced
+**               by parse_game.
+**             Player *game - where the scores are stored.
+** Pre-Conditions: pins holds a legal, complete game.
+** Post-Conditions: game->frame_s[] and game->total_s hold the scores.
+** Return: N/A
+*********************************************************************/
+void score_balls(const int *pins, Player *game) {
+    int ball = 0, total = 0;
+    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+        int strike = (pins[ball] == 10);
+        int two_balls = pins[ball] + pins[ball + 1];
+        int bonus = (strike | (two_balls == 10)) * pins[ball + 2];
+        // A strike's two bonus balls are pins[ball + 1] and pins[ball + 2],
+        // which two_balls and bonus already cover.
+        game->frame_s[frame] = two_balls + bonus;
+        total += two_balls + bonus;
+        ball += 2 - strike;
+    }
+    game->total_s = total;
+}
+
+/*********************************************************************
+** Function: append_int
+** Description: Writes the decimal digits of a non-negative integer.
+** Parameters: char *out - where the digits should be written.
+**             int x - the non-negative value to be written.
+** Pre-Conditions: out has room for at least 10 characters.
+** Post-Conditions: The digits of x have been written starting at out.
+** Return: A pointer to the character after the last digit written.
+*********************************************************************/
+char* append_int(char *out, int x) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + x % 10;
+        x /= 10;
+    }while (x);
+    while (n)
+        *out++ = digits[--n];
+    return out;
+}
+
+/*********************************************************************
+** Function: uniform_pin_model
+** Description: Fills a PinModel with the uniform model used by bowl(),
+**   in which every number of pins from 0 to pins_standing is equally
+**   likely regardless of the ball.
+** Parameters: PinModel *model - the model to be filled.
+** Pre-Conditions: N/A
+** Post-Conditions: model holds the uniform pin model.
+** Return: N/A
+*********************************************************************/
+void uniform_pin_model(PinModel *model) {
+    for (int rack = 0; rack < 2; ++rack)
+        for (int standing = 0; standing <= 10; ++standing)
+            for (int k = 0; k <= 10; ++k)
+                model->p[rack][standing][k] = (k <= standing ? 1.0 / (standing + 1) : 0);
+}
+
+/*********************************************************************
+** Function: exact_distribution
+** Description: Computes the exact probability of every final score by
+**   propagating probability mass frame by frame over the pending bonus
+**   state (none, spare, strike, or two strikes in a row) and the running
+**   total, following the same rules as update_score and fill_balls.
+** Parameters: const PinModel *model - the per-ball pin model.
+**             double *distribution - an array of 301 doubles that will
+**               hold the probability of each score from 0 to 300.
+** Pre-Conditions: Each row of model sums to 1.
+** Post-Conditions: distribution holds the exact score distribution.
+** Return: N/A
+*********************************************************************/
+void exact_distribution(const PinModel *model, double *distribution) {
+    double state[4][301] = {}, next[4][301];
+    state[0][0] = 1;
+    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+        add_frame(model, state, next, frame == FINAL_FRAME);
+        memcpy(state, next, sizeof(state));
+    }
+    for (int score = 0; score <= 300; ++score)
+        distribution[score] = state[0][score] + state[1][score] + state[2][score] + state[3][score];
+}
+
+/*********************************************************************
+** Function: add_frame
+** Description: Advances the dynamic program by one frame. States are
+**   0 (no bonus pending), 1 (spare pending), 2 (strike pending), and
+**   3 (two strikes pending). The first ball of a frame is counted once
+**   more for a pending spare or strike and twice more after two strikes;
+**   the second ball is counted once more after a strike.
+** Parameters: const PinModel *model - the per-ball pin model.
+**             const double from[4][301] - probability of each state and
+**               running total before the frame.
+**             double to[4][301] - probability of each state and running
+**               total after the frame.
+**             bool final_frame - whether this is the tenth frame, which
+**               awards fill balls and leaves no bonus pending.
+** Pre-Conditions: N/A
+** Post-Conditions: to holds the distribution after the frame.
+** Return: N/A
+*********************************************************************/
+void add_frame(const PinModel *model, const double from[4][301], double to[4][301], bool final_frame) {
+    const int first_bonus[4] = {0, 1, 1, 2}, second_bonus[4] = {0, 0, 1, 1};
+    memset(to, 0, 4 * 301 * sizeof(double));
+
+    for (int s = 0; s < 4; ++s)
+        for (int total = 0; total <= 300; ++total) {
+            double mass = from[s][total];
+            if (!mass)
+                continue;
+            for (int a = 0; a <= 10; ++a) {
+                double pa = mass * model->p[1][10][a];
+                if (!pa)
+                    continue;
+                int after_a = total + a * (1 + first_bonus[s]);
+                if (a == 10) {
+                    if (!final_frame) {
+                        to[s >= 2 ? 3 : 2][after_a] += pa;
+                        continue;
+                    }
+                    for (int b = 0; b <= 10; ++b) {
+                        double pb = pa * model->p[1][10][b];
+                        int after_b = after_a + b * (1 + second_bonus[s]);
+                        int rack = (b == 10), standing = (b == 10 ? 10 : 10 - b);
+                        for (int c = 0; pb && c <= standing; ++c)
+                            to[0][after_b + c] += pb * model->p[rack][standing][c];
+                    }
+                    continue;
+                }
+                for (int b = 0; b <= 10 - a; ++b) {
+                    double pb = pa * model->p[0][10 - a][b];
+                    if (!pb)
+                        continue;
+                    int after_b = after_a + b * (1 + second_bonus[s]);
+                    if (a + b < 10)
+                        to[0][after_b] += pb;
+                    else if (!final_frame)
+                        to[1][after_b] += pb;
+                    else for (int c = 0; c <= 10; ++c)
+                        to[0][after_b + c] += pb * model->p[1][10][c];
+                }
+            }
+        }
+}
+
+/*********************************************************************
+** Function: print_exact_report
+** Description: Prints the probability of every attainable score, the
+**   mean and standard deviation, and the probability of a perfect game.
+**   If Monte Carlo results are supplied, also prints how far the
+**   sampled distribution is from the exact one.
+** Parameters: const double *distribution - the exact distribution.
+**             const SimStats *sampled - Monte Carlo results, or a null
+**               pointer.
+** Pre-Conditions: distribution holds 301 probabilities.
+** Post-Conditions: The report has been printed to the console.
+** Return: N/A
+*********************************************************************/
+void print_exact_report(const double *distribution, const SimStats *sampled) {
+    double mean = 0, variance = 0;
+    for (int i = 0; i <= 300; ++i)
+        mean += i * distribution[i];
+    for (int i = 0; i <= 300; ++i)
+        variance += distribution[i] * (i - mean) * (i - mean);
+
+    cout << "Score  Probability\n";
+    for (int i = 0; i <= 300; ++i)
+        if (distribution[i])
+            cout << setw(5) << i << "  " << scientific << setprecision(6) << distribution[i] << '\n';
+    cout << fixed << setprecision(3) << "\nMean score: " << mean << " (std. dev. " << sqrt(variance) << ')'
+         << scientific << setprecision(6) << "\nP(300): " << distribution[300] << endl;
+
+    if (!sampled || !sampled->games)
+        return;
+    double distance = 0, worst = 0;
+    int worst_score = 0;
+    for (int i = 0; i <= 300; ++i) {
+        double diff = fabs((double)sampled->histogram[i] / sampled->games - distribution[i]);
+        distance += diff / 2;
+        if (diff > worst) {
+            worst = diff;
+            worst_score = i;
+        }
+    }
+    cout << "\nMonte Carlo games: " << sampled->games
+         << fixed << setprecision(3) << "\nMonte Carlo mean: " << (double)sampled->total_pins / sampled->games
+         << scientific << setprecision(3) << "\nTotal variation distance: " << distance
+         << "\nLargest difference: " << worst << " at score " << worst_score << endl;
+}
+
+/*********************************************************************
+** Function: load_pin_models
+** Description: Reads bowler profiles from a file. A line of the form
+**   "bowler <name>" starts a profile, and lines of the form
+**   "first <standing> w0 ... w<standing>" or "second <standing> w0 ...
+**   w<standing>" give relative weights for knocking down 0 through
+**   <standing> pins on the first ball at a fresh rack or on a later
+**   ball. Rows that are not listed stay uniform. Blank lines and lines
+**   starting with '#' are ignored.
+** Parameters: const char *path - the file to read.
+**             vector<PinModel> &models - where the profiles are added.
+** Pre-Conditions: N/A
+** Post-Conditions: Every profile in the file has been normalized, had
+**   its alias tables built, and been appended to models.
+** Return: True if the file was read without errors, false otherwise.
+*********************************************************************/
+bool load_pin_models(const char *path, vector<PinModel> &models) {
+    ifstream in(path);
+    if (!in)
+        return false;
+    string line, word;
+    size_t first_new = models.size();
+    while (getline(in, line)) {
+        istringstream fields(line);
+        if (!(fields >> word) || word[0] == '#')
+            continue;
+        if (word == "bowler") {
+            models.push_back(PinModel());
+            uniform_pin_model(&models.back());
+            getline(fields >> ws, word);
+            strncpy(models.back().name, word.c_str(), 63);
+            continue;
+        }
+        int standing;
+        if (models.size() == first_new || (word != "first" && word != "second") || !(fields >> standing)
+            || standing < 1 || standing > 10)
+            return false;
+
+        double *row = models.back().p[word == "first"][standing], sum = 0;
+        for (int k = 0; k <= standing; ++k) {
+            if (!(fields >> row[k]) || row[k] < 0)
+                return false;
+            sum += row[k];
+        }
+        if (sum <= 0)
+            return false;
+        for (int k = 0; k <= standing; ++k)
+            row[k] /= sum;
+    }
+    for (size_t i = first_new; i < models.size(); ++i)
+        build_alias_tables(&models[i]);
+    return models.size() > first_new;
+}
+
+/*********************************************************************
+** Function: build_alias_tables
+** Description: Builds a Walker/Vose alias table (see alias.h) for
+**   every row of the model so that sample_pins can draw from it in
+**   constant time.
+** Parameters: PinModel *model - the model whose tables are built.
+** Pre-Conditions: Each row of model->p sums to 1.
+** Post-Conditions: model->threshold[][][] and model->alias[][][] have
+**   been filled in.
+** Return: N/A
+*********************************************************************/
+void build_alias_tables(PinModel *model) {
+    for (int rack = 0; rack < 2; ++rack)
+        for (int standing = 0; standing <= 10; ++standing)
+            build_alias_table(model->p[rack][standing], standing + 1, model->threshold[rack][standing],
+                              model->alias[rack][standing]);
+}
+
+/*********************************************************************
+** Function: sample_pins
+** Description: Draws the number of pins knocked down from the model's
+**   alias table for the current rack and pins standing.
+** Parameters: const PinModel *model - the pin model.
+**             int pins_left - the number of pins standing.
+**             bool new_rack - whether this is the first ball at a
+**               freshly set rack.
+** Pre-Conditions: build_alias_tables has been called on model, and
+**   pins_left is from 1 to 10.
+** Post-Conditions: N/A
+** Return: The number of pins knocked down, between 0 and pins_left.
+*********************************************************************/
+int sample_pins(const PinModel *model, int pins_left, bool new_rack) {
+    return sample_alias(&pin_rng, pins_left + 1, model->threshold[new_rack][pins_left],
+                        model->alias[new_rack][pins_left]);
+}
+
+/*********************************************************************
+** Function: find_pin_model
+** Description: Looks up a bowler's profile by name.
+** Parameters: const vector<PinModel> &models - the loaded profiles.
+**             const char *name - the bowler's name.
+** Pre-Conditions: name points to a C-style string.
+** Post-Conditions: N/A
+** Return: A pointer to the matching profile, or a null pointer if there
+**   is none.
+*********************************************************************/
+const PinModel* find_pin_model(const vector<PinModel> &models, const char *name) {
+    for (size_t i = 0; i < models.size(); ++i)
+        if (!strcmp(models[i].name, name))
+            return &models[i];
+    return 0;
+}
+
+/*********************************************************************
+** Function: intern_name
+** Description: Returns the id of a league bowler, adding the bowler
+**   (and growing every per-bowler column) if the name is new.
+** Parameters: League *league - the league.
+**             const char *name - the bowler's name.
+** Pre-Conditions: name points to a C-style string.
+** Post-Conditions: The name is stored exactly once in the name pool.
+** Return: The bowler's id, from 0 to league->size - 1.
+*********************************************************************/
+int intern_name(League *league, const char *name) {
+    unordered_map<string, int>::iterator found = league->name_ids.find(name);
+    if (found != league->name_ids.end())
+        return found->second;
+
+    int id = league->size++;
+    league->name_ids[name] = id;
+    league->name_offset.push_back(league->name_pool.size());
+    league->name_pool.insert(league->name_pool.end(), name, name + strlen(name) + 1);
+    league->model.push_back(0);
+    league->bowls.resize(21 * league->size);
+    league->frame_s.resize(10 * league->size);
+    league->total_s.push_back(0);
+    league->games_played.push_back(0);
+    league->season_pins.push_back(0);
+    league->high_game.push_back(0);
+    league->wins.push_back(0);
+    return id;
+}
+
+/*********************************************************************
+** Function: league_name
+** Description: Looks up an interned bowler name.
+** Parameters: const League *league - the league.
+**             int id - the bowler's id.
+** Pre-Conditions: id is from 0 to league->size - 1.
+** Post-Conditions: N/A
+** Return: The bowler's name as a C-style string.
+*********************************************************************/
+const char* league_name(const League *league, int id) {
+    return &league->name_pool[league->name_offset[id]];
+}
+
+/*********************************************************************
+** Function: play_league_game
+** Description: Plays one headless game for every bowler in the league,
+**   bowling straight into the reused per-game columns, and then adds
+**   them to the season columns with one linear pass.
+** Parameters: League *league - the league.
+** Pre-Conditions: N/A
+** Post-Conditions: The per-game columns hold this game and the season
+**   columns include it.
+** Return: N/A
+*********************************************************************/
+void play_league_game(League *league) {
+    fill(league->bowls.begin(), league->bowls.end(), 0);
+    fill(league->frame_s.begin(), league->frame_s.end(), 0);
+    fill(league->total_s.begin(), league->total_s.end(), 0);
+    for (int i = 0; i < league->size; ++i)
+        simulate_columns(&league->bowls[21 * i], &league->frame_s[10 * i], &league->total_s[i], league->model[i]);
+    for (int i = 0; i < league->size; ++i) {
+        int total = league->total_s[i];
+        ++league->games_played[i];
+        league->season_pins[i] += total;
+        league->high_game[i] = max(league->high_game[i], total);
+    }
+}
+
+/*********************************************************************
+** Function: league_leader
+** Description: Finds the bowler with the highest score in the current
+**   game by scanning the total_s column, like declare_winner.
+** Parameters: const League *league - the league.
+** Pre-Conditions: league->size is positive.
+** Post-Conditions: N/A
+** Return: The id of the winner, or -1 if the high score was tied.
+*********************************************************************/
+int league_leader(const League *league) {
+    const int *total = &league->total_s[0];
+    int best = 0;
+    bool tie = false;
+    for (int i = 1; i < league->size; ++i) {
+        if (total[i] == total[best])
+            tie = true;
+        else if (total[i] > total[best]) {
+            best = i;
+            tie = false;
+        }
+    }
+    return (tie ? -1 : best);
+}
+
+/*********************************************************************
+** Function: run_league
+** Description: Plays a season of league games, crediting the winner of
+**   each, and prints the season report. Each game night is appended to
+**   the game log if one is given.
+** Parameters: League *league - the league.
+**             int games - the number of games in the season.
+**             HistoryWriter *writer - the game log, or a null pointer.
+** Pre-Conditions: N/A
+** Post-Conditions: The season has been played and reported.
+** Return: N/A
+*********************************************************************/
+void run_league(League *league, int games, HistoryWriter *writer) {
+    if (league->size < 1) {
+        cout << "The league has no bowlers." << endl;
+        return;
+    }
+    vector<uint32_t> history_id(league->size);
+    vector<GameRecord> records(league->size);
+    for (int i = 0; writer && i < league->size; ++i)
+        history_id[i] = history_player_id(writer, league_name(league, i));
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int g = 0; g < games; ++g) {
+        play_league_game(league);
+        int winner = league_leader(league);
+        if (winner >= 0)
+            ++league->wins[winner];
+        if (!writer)
+            continue;
+
+        for (int i = 0; i < league->size; ++i) {
+            GameRecord &r = records[i];
+            r = GameRecord();
+            r.game_id = writer->next_game;
+            r.player_id = history_id[i];
+            for (int frame = 0; frame <= FINAL_FRAME; ++frame)
+                r.frame_s[frame] = league->frame_s[10 * i + frame];
+            r.total_s = league->total_s[i];
+            memcpy(r.bowls, &league->bowls[21 * i], 21);
+        }
+        fwrite(&records[0], sizeof(GameRecord), records.size(), writer->records);
+        ++writer->next_game;
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    print_league_report(league, 10, elapsed.count());
+}
+
+/*********************************************************************
+** Function: print_league_report
+** Description: Prints the top bowlers by season average along with
+**   their high games and wins, and the league's throughput.
+** Parameters: const League *league - the league.
+**             int top - how many bowlers to list.
+**             double seconds - how long the season took to play.
+** Pre-Conditions: Every bowler has played at least one game.
+** Post-Conditions: The report has been printed to the console.
+** Return: N/A
+*********************************************************************/
+void print_league_report(const League *league, int top, double seconds) {
+    vector<int> order(league->size);
+    for (int i = 0; i < league->size; ++i)
+        order[i] = i;
+    top = min(top, league->size);
+    // Every bowler plays every game, so ranking by pins is ranking by average.
+    const long long *pins = &league->season_pins[0];
+    partial_sort(order.begin(), order.begin() + top, order.end(),
+                 [pins](int a, int b) { return pins[a] > pins[b]; });
+
+    int high = 0;
+    for (int i = 1; i < league->size; ++i)
+        if (league->high_game[i] > league->high_game[high])
+            high = i;
+
+    cout << "Rank  Name                  Average  High  Wins\n";
+    for (int r = 0; r < top; ++r) {
+        int id = order[r];
+        cout << setfill(' ') << setw(4) << r + 1 << "  " << left << setw(20) << league_name(league, id) << right
+             << fixed << setprecision(2) << setw(9) << (double)pins[id] / league->games_played[id]
+             << setw(6) << league->high_game[id] << setw(6) << league->wins[id] << '\n';
+    }
+    long long games = (long long)league->size * league->games_played[0];
+    cout << "\nHigh game: " << league->high_game[high] << " by " << league_name(league, high)
+         << "\nGames played: " << games
+         << "\nThroughput: " << setprecision(0) << games / (seconds > 0 ? seconds : 1e-9) << " games/s" << endl;
+}
+
+/*********************************************************************
+** Function: open_history_writer
+** Description: Opens a game log and its names file for appending,
+**   creating them if needed, and loads the names already assigned ids
+**   and the id the next game will get.
+** Parameters: const char *path - the game log file.
+**             HistoryWriter *writer - the writer to set up.
+** Pre-Conditions: N/A
+** Post-Conditions: writer is ready for write_history_game.
+** Return: True if both files were opened, false otherwise.
+*********************************************************************/
+bool open_history_writer(const char *path, HistoryWriter *writer) {
+    string names_path = string(path) + ".names", name;
+    ifstream names_in(names_path.c_str());
+    while (getline(names_in, name))
+        writer->ids.insert(make_pair(name, (uint32_t)writer->ids.size()));
+
+    writer->records = fopen(path, "ab+");
+    writer->names = fopen(names_path.c_str(), "a");
+    if (!writer->records || !writer->names) {
+        close_history_writer(writer);
+        return false;
+    }
+
+    fseek(writer->records, 0, SEEK_END);
+    long size = ftell(writer->records);
+    HistoryHeader header = {HISTORY_MAGIC, HISTORY_VERSION, sizeof(GameRecord), 0};
+    if (size < (long)sizeof(HistoryHeader))
+        fwrite(&header, sizeof(header), 1, writer->records);
+    else {
+        GameRecord last;
+        fseek(writer->records, 0, SEEK_SET);
+        if (fread(&header, sizeof(header), 1, writer->records) != 1 || header.magic != HISTORY_MAGIC
+            || header.record_size != sizeof(GameRecord)) {
+            close_history_writer(writer);
+            return false;
+        }
+        if (size >= (long)(sizeof(HistoryHeader) + sizeof(GameRecord))) {
+            fseek(writer->records, size - sizeof(GameRecord), SEEK_SET);
+            if (fread(&last, sizeof(last), 1, writer->records) == 1)
+                writer->next_game = last.game_id + 1;
+        }
+    }
+    fseek(writer->records, 0, SEEK_END);
+    return true;
+}
+
+/*********************************************************************
+** Function: history_player_id
+** Description: Returns a player's id in the game log, adding the name
+**   to the names file if it has not been seen before.
+** Parameters: HistoryWriter *writer - the open game log.
+**             const char *name - the player's name.
+** Pre-Conditions: writer was opened by open_history_writer.
+** Post-Conditions: name has an id in the names file.
+** Return: The player's id.
+*********************************************************************/
+uint32_t history_player_id(HistoryWriter *writer, const char *name) {
+    unordered_map<string, uint32_t>::iterator found = writer->ids.find(name);
+    if (found != writer->ids.end())
+        return found->second;
+    uint32_t id = writer->ids.size();
+    writer->ids[name] = id;
+    fprintf(writer->names, "%s\n", name);
+    return id;
+}
+
+/*********************************************************************
+** Function: write_history_game
+** Description: Appends one finished game to the log, one record per
+**   player, all sharing the next game id.
+** Parameters: HistoryWriter *writer - the open game log.
+**             int num_p - the number of players.
+**             const Player *p_list - the players' finished games.
+** Pre-Conditions: writer was opened by open_history_writer.
+** Post-Conditions: The game has been appended to the log.
+** Return: N/A
+*********************************************************************/
+void write_history_game(HistoryWriter *writer, int num_p, const Player *p_list) {
+    for (int i = 0; i < num_p; ++i) {
+        GameRecord r = GameRecord();
+        r.game_id = writer->next_game;
+        r.player_id = history_player_id(writer, p_list[i].name);
+        for (int frame = 0; frame <= FINAL_FRAME; ++frame)
+            r.frame_s[frame] = p_list[i].frame_s[frame];
+        r.total_s = p_list[i].total_s;
+        memcpy(r.bowls, p_list[i].bowls, 21);
+        fwrite(&r, sizeof(r), 1, writer->records);
+    }
+    ++writer->next_game;
+    fflush(writer->records);
+    fflush(writer->names);
+}
+
+/*********************************************************************
+** Function: close_history_writer
+** Description: Closes the files of a game log writer, if open.
+** Parameters: HistoryWriter *writer - the game log writer.
+** Pre-Conditions: N/A
+** Post-Conditions: Both files have been flushed and closed.
+** Return: N/A
+*********************************************************************/
+void close_history_writer(HistoryWriter *writer) {
+    if (writer->records)
+        fclose(writer->records);
+    if (writer->names)
+        fclose(writer->names);
+    writer->records = writer->names = 0;
+}
+
+/*********************************************************************
+** Function: open_history
+** Description: Memory-maps a game log for reading and loads its names.
+** Parameters: const char *path - the game log file.
+**             History *history - the view to set up.
+** Pre-Conditions: N/A
+** Post-Conditions: history->games points to history->count records.
+** Return: True if the log was mapped and has a valid header, false
+**   otherwise.
+*********************************************************************/
+bool open_history(const char *path, History *history) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) || info.st_size < (off_t)sizeof(HistoryHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    history->map = map;
+    history->map_size = info.st_size;
+
+    const HistoryHeader *header = (const HistoryHeader*)map;
+    if (header->magic != HISTORY_MAGIC || header->record_size != sizeof(GameRecord)) {
+        close_history(history);
+        return false;
+    }
+    history->games = (const GameRecord*)(header + 1);
+    history->count = (info.st_size - sizeof(HistoryHeader)) / sizeof(GameRecord);
+
+    ifstream names_in((string(path) + ".names").c_str());
+    string name;
+    while (getline(names_in, name))
+        history->names.push_back(name);
+    return true;
+}
+
+/*********************************************************************
+** Function: close_history
+** Description: Unmaps a game log.
+** Parameters: History *history - the mapped game log.
+** Pre-Conditions: N/A
+** Post-Conditions: history no longer refers to any memory.
+** Return: N/A
+*********************************************************************/
+void close_history(History *history) {
+    if (history->map)
+        munmap(history->map, history->map_size);
+    history->map = 0;
+    history->games = 0;
+    history->count = 0;
+}
+
+/*********************************************************************
+** Function: print_history_stats
+** Description: Prints every player's games, average, and high game,
+**   gathered in a single pass over the mapped records.
+** Parameters: const History *history - the mapped game log.
+** Pre-Conditions: N/A
+** Post-Conditions: The season statistics have been printed.
+** Return: N/A
+*********************************************************************/
+void print_history_stats(const History *history) {
+    size_t players = history->names.size();
+    vector<long long> pins(players), games(players);
+    vector<int> high(players);
+    for (size_t i = 0; i < history->count; ++i) {
+        const GameRecord &r = history->games[i];
+        if (r.player_id >= players)
+            continue;
+        ++games[r.player_id];
+        pins[r.player_id] += r.total_s;
+        high[r.player_id] = max(high[r.player_id], (int)r.total_s);
+    }
+    cout << "Name                  Games  Average  High\n";
+    for (size_t p = 0; p < players; ++p)
+        if (games[p])
+            cout << left << setw(20) << history->names[p] << right << setw(7) << games[p]
+                 << fixed << setprecision(2) << setw(9) << (double)pins[p] / games[p] << setw(6) << high[p] << '\n';
+    cout << "\nRecords: " << history->count << endl;
+}
+
+/*********************************************************************
+** Function: print_high_games
+** Description: Prints the highest individual games in the log.
+** Parameters: const History *history - the mapped game log.
+**             int top - how many games to list.
+** Pre-Conditions: N/A
+** Post-Conditions: The high games have been printed.
+** Return: N/A
+*********************************************************************/
+void print_high_games(const History *history, int top) {
+    top = max(0, min(top, (int)history->count));
+    vector<const GameRecord*> best;
+    best.reserve(history->count);
+    for (size_t i = 0; i < history->count; ++i)
+        best.push_back(&history->games[i]);
+    partial_sort(best.begin(), best.begin() + top, best.end(),
+                 [](const GameRecord *a, const GameRecord *b) { return a->total_s > b->total_s; });
+
+    cout << "Score  Game      Name\n";
+    for (int i = 0; i < top; ++i)
+        cout << setw(5) << best[i]->total_s << "  " << left << setw(8) << best[i]->game_id << right << "  "
+             << (best[i]->player_id < history->names.size() ? history->names[best[i]->player_id] : "?") << '\n';
+}
+
+/*********************************************************************
+** Function: print_head_to_head
+** Description: Counts the games in which both players bowled and how
+**   many each of them won. Records of one game are stored together, so
+**   a single pass that tracks the current game id is enough.
+** Parameters: const History *history - the mapped game log.
+**             const char *a - the first player's name.
+**             const char *b - the second player's name.
+** Pre-Conditions: N/A
+** Post-Conditions: The head-to-head record has been printed.
+** Return: N/A
+*********************************************************************/
+void print_head_to_head(const History *history, const char *a, const char *b) {
+    long long id_a = -1, id_b = -1;
+    for (size_t p = 0; p < history->names.size(); ++p) {
+        if (history->names[p] == a)
+            id_a = p;
+        if (history->names[p] == b)
+            id_b = p;
+    }
+    if (id_a < 0 || id_b < 0) {
+        cout << "Both players must appear in the game history." << endl;
+        return;
+    }
+
+    long long met = 0, wins_a = 0, wins_b = 0;
+    size_t i = 0;
+    while (i < history->count) {
+        uint32_t game = history->games[i].game_id;
+        int score_a = -1, score_b = -1;
+        for (; i < history->count && history->games[i].game_id == game; ++i) {
+            if (history->games[i].player_id == id_a)
+                score_a = history->games[i].total_s;
+            else if (history->games[i].player_id == id_b)
+                score_b = history->games[i].total_s;
+        }
+        if (score_a < 0 || score_b < 0)
+            continue;
+        ++met;
+        wins_a += (score_a > score_b);
+        wins_b += (score_b > score_a);
+    }
+    cout << a << " vs. " << b << ": " << met << " games, " << wins_a << '-' << wins_b
+         << " (" << met - wins_a - wins_b << " tied)" << endl;
+}
+
+/*********************************************************************
+** Function: strike_biased_model
+** Description: Builds the importance-sampling proposal from a pin model
+**   by raising the probability of a strike on every fresh rack to bias
+**   and scaling the other first-ball outcomes down proportionally. All
+**   other balls are left unchanged.
+** Parameters: const PinModel *model - the true pin model.
+**             double bias - the proposal's strike probability.
+**             PinModel *proposal - where the proposal is stored.
+** Pre-Conditions: bias is strictly between 0 and 1, and the true model
+**   gives a strike on a fresh rack a positive probability.
+** Post-Conditions: proposal holds the biased model and its alias tables.
+** Return: N/A
+*********************************************************************/
+void strike_biased_model(const PinModel *model, double bias, PinModel *proposal) {
+    *proposal = *model;
+    double *row = proposal->p[1][10], rest = 1 - row[10];
+    for (int k = 0; k < 10; ++k)
+        row[k] = (rest > 0 ? row[k] * (1 - bias) / rest : (1 - bias) / 10);
+    row[10] = bias;
+    build_alias_tables(proposal);
+}
+
+/*********************************************************************
+** Function: likelihood_ratio
+** Description: Computes the ratio of a game's probability under the
+**   true model to its probability under the proposal it was bowled
+**   with, by replaying its balls with the same rack rules as bowl_frame
+**   and fill_balls.
+** Parameters: const Player *bowler - the finished game.
+**             const PinModel *model - the true pin model.
+**             const PinModel *proposal - the model the game was bowled
+**               with.
+** Pre-Conditions: bowler holds a complete game bowled with proposal.
+** Post-Conditions: N/A
+** Return: The likelihood ratio (importance weight) of the game.
+*********************************************************************/
+double likelihood_ratio(const Player *bowler, const PinModel *model, const PinModel *proposal) {
+    char line[21];
+    int n = 0, pins[21], ball = 0;
+    for (int i = 0; i < 21; ++i)
+        if (bowler->bowls[i])
+            line[n++] = bowler->bowls[i];
+    if (parse_game(line, line + n, pins))
+        return 0;
+
+    double ratio = 1;
+    for (int frame = 0; frame <= FINAL_FRAME; ++frame) {
+        int standing = 10, balls_in_frame = 0;
+        bool fresh = true;
+        while (true) {
+            int k = pins[ball++];
+            ratio *= model->p[fresh][standing][k] / proposal->p[fresh][standing][k];
+            standing -= k;
+            ++balls_in_frame;
+            if (frame != FINAL_FRAME) {
+                if (!standing || balls_in_frame == 2)
+                    break;
+                fresh = false;
+                continue;
+            }
+            fresh = !standing;
+            if (fresh)
+                standing = 10;
+            if (balls_in_frame == 3 || (balls_in_frame == 2 && pins[ball - 2] + pins[ball - 1] < 10))
+                break;
+        }
+    }
+    return ratio;
+}
+
+/*********************************************************************
+** Function: run_rare_events
+** Description: Estimates the probability of a high game and of a high
+**   three-game series by importance sampling across worker threads,
+**   and prints each estimate with its standard error, a 95% confidence
+**   interval, and how many plain Monte Carlo games would be needed for
+**   the same precision.
+** Parameters: long long series - the number of three-game series.
+**             int threads - the number of worker threads.
+**             uint64_t seed - the run's seed; thread i bowls with stream
+**               i of it.
+**             const PinModel *model - the true pin model, or a null
+**               pointer for the uniform model.
+**             double bias - the proposal's strike probability.
+**             int tail - the single-game score threshold.
+**             int series_tail - the series score threshold.
+** Pre-Conditions: N/A
+** Post-Conditions: The estimates have been printed.
+** Return: N/A
+*********************************************************************/
+void run_rare_events(long long series, int threads, uint64_t seed, const PinModel *model,
+                     double bias, int tail, int series_tail) {
+    PinModel uniform, proposal;
+    if (!model) {
+        uniform_pin_model(&uniform);
+        build_alias_tables(&uniform);
+        model = &uniform;
+    }
+    if (bias <= 0 || bias >= 1) {
+        cout << "The strike bias must be between 0 and 1." << endl;
+        return;
+    }
+    strike_biased_model(model, bias, &proposal);
+    series = max(series, 1LL);
+    threads = (int)max(1LL, min((long long)threads, series));
+
+    vector<TailEstimate> estimates(2 * threads);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i) {
+        long long share = series / threads + (i < series % threads);
+        workers.push_back(thread(sample_series, share, make_stream(seed, i), model, &proposal, tail, series_tail,
+                                 &estimates[2 * i]));
+    }
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    TailEstimate game, three;
+    for (int i = 0; i < threads; ++i) {
+        for (int e = 0; e < 2; ++e) {
+            TailEstimate &total = (e ? three : game), &part = estimates[2 * i + e];
+            total.samples += part.samples;
+            total.hits += part.hits;
+            total.sum += part.sum;
+            total.sum_sq += part.sum_sq;
+        }
+    }
+
+    double exact[301], exact_tail = 0;
+    exact_distribution(model, exact);
+    for (int score = max(tail, 0); score <= 300; ++score)
+        exact_tail += exact[score];
+
+    cout << "Strike bias: " << bias << "\n\n";
+    print_tail_estimate(("P(game >= " + to_string(tail) + ")").c_str(), &game, exact_tail);
+    print_tail_estimate(("P(series >= " + to_string(series_tail) + ")").c_str(), &three, -1);
+    cout << "Time: " << fixed << setprecision(3) << elapsed.count() << " s" << endl;
+}
+
+/*********************************************************************
+** Function: sample_series
+** Description: Thread body for run_rare_events. Bowls three-game series
+**   with the proposal model and adds each game and each series to its
+**   tail estimate, weighted by its likelihood ratio.
+** Parameters: long long series - how many series this thread bowls.
+**             RandomStream stream - this thread's random stream.
+**             const PinModel *model - the true pin model.
+**             const PinModel *proposal - the biased pin model.
+**             int tail - the single-game score threshold.
+**             int series_tail - the series score threshold.
+**             TailEstimate *estimates - two accumulators, for games and
+**               for series, that no other thread writes to.
+** Pre-Conditions: proposal has its alias tables built.
+** Post-Conditions: estimates include every sample bowled.
+** Return: N/A
+*********************************************************************/
+void sample_series(long long series, RandomStream stream, const PinModel *model, const PinModel *proposal,
+                   int tail, int series_tail, TailEstimate *estimates) {
+    pin_rng = stream;
+    for (long long s = 0; s < series; ++s) {
+        double series_weight = 1;
+        int series_total = 0;
+        for (int g = 0; g < 3; ++g) {
+            Player bowler;
+            bowler.model = proposal;
+            simulate_game(&bowler);
+            double weight = likelihood_ratio(&bowler, model, proposal);
+            add_sample(&estimates[0], bowler.total_s >= tail, weight);
+            series_weight *= weight;
+            series_total += bowler.total_s;
+        }
+        add_sample(&estimates[1], series_total >= series_tail, series_weight);
+    }
+}
+
+/*********************************************************************
+** Function: add_sample
+** Description: Adds one weighted sample to a tail estimate.
+** Parameters: TailEstimate *estimate - the accumulator.
+**             bool hit - whether the sample landed in the tail.
+**             double weight - the sample's likelihood ratio.
+** Pre-Conditions: N/A
+** Post-Conditions: estimate includes the sample.
+** Return: N/A
+*********************************************************************/
+void add_sample(TailEstimate *estimate, bool hit, double weight) {
+    ++estimate->samples;
+    if (!hit)
+        return;
+    ++estimate->hits;
+    estimate->sum += weight;
+    estimate->sum_sq += weight * weight;
+}
+
+/*********************************************************************
+** Function: print_tail_estimate
+** Description: Prints an importance-sampling estimate with its sample
+**   count, sample variance, standard error, 95% confidence interval,
+**   and the number of plain Monte Carlo samples that would give the
+**   same standard error.
+** Parameters: const char *label - what is being estimated.
+**             const TailEstimate *estimate - the accumulator.
+**             double exact - the exact probability for comparison, or
+**               a negative number if it is not known.
+** Pre-Conditions: estimate->samples is positive.
+** Post-Conditions: The estimate has been printed.
+** Return: N/A
+*********************************************************************/
+void print_tail_estimate(const char *label, const TailEstimate *estimate, double exact) {
+    double n = estimate->samples, mean = estimate->sum / n;
+    double variance = (n > 1 ? (estimate->sum_sq - n * mean * mean) / (n - 1) : 0);
+    variance = max(variance, 0.0);
+    double error = sqrt(variance / n);
+
+    cout << label << ": " << scientific << setprecision(4) << mean
+         << "\n  samples: " << estimate->samples << " (" << estimate->hits << " in the tail)"
+         << "\n  sample variance: " << variance
+         << "\n  standard error: " << error
+         << "\n  95% interval: [" << max(0.0, mean - 1.96 * error) << ", " << mean + 1.96 * error << ']';
+    if (error > 0)
+        cout << "\n  plain Monte Carlo samples for the same error: " << mean * (1 - mean) / (error * error);
+    if (exact >= 0)
+        cout << "\n  exact: " << exact;
+    cout << "\n\n";
+}
+
+/*********************************************************************
+** Function: run_lanes
+** Description: Hosts many independent lane sessions in one process.
+**   Each lane's next frame is a task; the tasks are dealt out to the
+**   workers' deques and the workers bowl them, stealing from each other
+**   when they run dry. Prints the top of the shared standings and the
+**   center's throughput.
+** Parameters: int num_lanes - the number of lanes.
+**             int bowlers - the number of bowlers on each lane.
+**             int games - the number of games each lane bowls.
+**             int threads - the number of worker threads.
+**             uint64_t seed - the run's seed; lane i bowls with stream i
+**               of it, so results do not depend on which worker bowls
+**               which frame.
+**             const PinModel *model - the pin model every bowler uses,
+**               or a null pointer for the uniform model.
+** Pre-Conditions: N/A
+** Post-Conditions: Every lane has finished and the report is printed.
+** Return: N/A
+*********************************************************************/
+void run_lanes(int num_lanes, int bowlers, int games, int threads, uint64_t seed, const PinModel *model) {
+    num_lanes = max(num_lanes, 1);
+    bowlers = max(bowlers, 1);
+    games = max(games, 1);
+    threads = max(1, min(threads, num_lanes));
+
+    Standings standings;
+    standings.size = num_lanes * bowlers;
+    standings.pins = new atomic<long long>[standings.size];
+    standings.games = new atomic<int>[standings.size];
+    standings.high = new atomic<int>[standings.size];
+    standings.wins = new atomic<int>[standings.size];
+    for (int i = 0; i < standings.size; ++i) {
+        standings.pins[i] = 0;
+        standings.games[i] = 0;
+        standings.high[i] = 0;
+        standings.wins[i] = 0;
+    }
+
+    vector<Lane> lanes(num_lanes);
+    vector<WorkQueue> queues(threads);
+    for (int l = 0; l < num_lanes; ++l) {
+        lanes[l].players.resize(bowlers);
+        for (int b = 0; b < bowlers; ++b)
+            lanes[l].players[b].model = model;
+        lanes[l].rng = make_stream(seed, l);
+        lanes[l].first_bowler = l * bowlers;
+        lanes[l].games_left = games;
+        queues[l % threads].tasks.push_back(l);
+    }
+
+    atomic<int> lanes_left(num_lanes);
+    atomic<long long> steals(0);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+        workers.push_back(thread(lane_worker, i, threads, make_stream(seed, num_lanes + i), &lanes, &queues[0], &standings,
+                                 &lanes_left, &steals));
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    vector<int> order(standings.size);
+    for (int i = 0; i < standings.size; ++i)
+        order[i] = i;
+    int top = min(10, standings.size);
+    partial_sort(order.begin(), order.begin() + top, order.end(),
+                 [&standings](int a, int b) { return standings.pins[a] > standings.pins[b]; });
+
+    cout << "Rank  Lane  Bowler  Average  High  Wins\n";
+    for (int r = 0; r < top; ++r) {
+        int id = order[r];
+        cout << setw(4) << r + 1 << setw(6) << id / bowlers + 1 << setw(8) << id % bowlers + 1
+             << fixed << setprecision(2) << setw(9) << (double)standings.pins[id] / standings.games[id]
+             << setw(6) << standings.high[id] << setw(6) << standings.wins[id] << '\n';
+    }
+    double total_games = (double)standings.size * games, seconds = max(elapsed.count(), 1e-9);
+    cout << "\nLanes: " << num_lanes << ", threads: " << threads << ", tasks stolen: " << steals
+         << "\nGames bowled: " << setprecision(0) << total_games
+         << "\nThroughput: " << total_games / seconds << " games/s, "
+         << total_games * 10 / seconds << " frames/s" << endl;
+
+    delete[] standings.pins;
+    delete[] standings.games;
+    delete[] standings.high;
+    delete[] standings.wins;
+}
+
+/*********************************************************************
+** Function: lane_worker
+** Description: Thread body for run_lanes. Repeatedly takes a lane task,
+**   bowls that lane's next frame, and pushes the lane back onto its own
+**   deque until the lane's session is over. Exits once every lane has
+**   finished.
+** Parameters: int self - this worker's index.
+**             int threads - the number of workers.
+**             RandomStream victims - this worker's stream for choosing
+**               whom to steal from.
+**             vector<Lane> *lanes - every lane in the center.
+**             WorkQueue *queues - the array of every worker's deque.
+**             Standings *standings - the shared league standings.
+**             atomic<int> *lanes_left - lanes that have not finished.
+**             atomic<long long> *steals - count of stolen tasks.
+** Pre-Conditions: Each lane's task is in exactly one deque.
+** Post-Conditions: N/A
+** Return: N/A
+*********************************************************************/
+void lane_worker(int self, int threads, RandomStream victims, vector<Lane> *lanes, WorkQueue *queues,
+                 Standings *standings, atomic<int> *lanes_left, atomic<long long> *steals) {
+    int task;
+    while (*lanes_left > 0) {
+        if (!next_task(self, threads, queues, &victims, &task, steals)) {
+            this_thread::yield();
+            continue;
+        }
+        Lane &lane = (*lanes)[task];
+        bowl_lane_frame(&lane, standings);
+        if (lane.games_left) {
+            lock_guard<mutex> guard(queues[self].lock);
+            queues[self].tasks.push_back(task);
+        }
+        else --*lanes_left;
+    }
+}
+
+/*********************************************************************
+** Function: next_task
+** Description: Takes the newest task from this worker's own deque, or
+**   failing that steals the oldest task from another worker's deque,
+**   starting from a pseudo-randomly chosen victim.
+** Parameters: int self - this worker's index.
+**             int threads - the number of workers.
+**             WorkQueue *queues - the array of every worker's deque.
+**             RandomStream *victims - this worker's victim stream.
+**             int *task - where the task's lane index is stored.
+**             atomic<long long> *steals - count of stolen tasks.
+** Pre-Conditions: N/A
+** Post-Conditions: If a task was found, it has been removed from its
+**   deque and stored in *task.
+** Return: True if a task was found, false otherwise.
+*********************************************************************/
+bool next_task(int self, int threads, WorkQueue *queues, RandomStream *victims, int *task,
+               atomic<long long> *steals) {
+    {
+        lock_guard<mutex> guard(queues[self].lock);
+        if (!queues[self].tasks.empty()) {
+            *task = queues[self].tasks.back();
+            queues[self].tasks.pop_back();
+            return true;
+        }
+    }
+    int first = random_below(victims, threads);
+    for (int i = 0; i < threads; ++i) {
+        int victim = (first + i) % threads;
+        if (victim == self)
+            continue;
+        lock_guard<mutex> guard(queues[victim].lock);
+        if (!queues[victim].tasks.empty()) {
+            *task = queues[victim].tasks.front();
+            queues[victim].tasks.pop_front();
+            ++*steals;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*********************************************************************
+** Function: bowl_lane_frame
+** Description: Bowls the lane's current frame for each of its bowlers
+**   with the usual bowl_frame rules, drawing from the lane's own random
+**   stream. When the tenth frame finishes, the game is posted to the
+**   standings and the lane is reset for its next game.
+** Parameters: Lane *lane - the lane whose frame is bowled.
+**             Standings *standings - the shared league standings.
+** Pre-Conditions: The calling worker holds the lane's task.
+** Post-Conditions: The lane has advanced by one frame.
+** Return: N/A
+*********************************************************************/
+void bowl_lane_frame(Lane *lane, Standings *standings) {
+    int num_p = lane->players.size();
+    pin_rng = lane->rng;
+    for (int b = 0; b < num_p; ++b)
+        bowl_frame(lane->frame, &lane->players[b], 0);
+    lane->rng = pin_rng;
+    if (++lane->frame <= FINAL_FRAME)
+        return;
+
+    int best = 0;
+    bool tie = false;
+    for (int b = 1; b < num_p; ++b) {
+        if (lane->players[b].total_s == lane->players[best].total_s)
+            tie = true;
+        else if (lane->players[b].total_s > lane->players[best].total_s) {
+            best = b;
+            tie = false;
+        }
+    }
+    for (int b = 0; b < num_p; ++b) {
+        update_standings(standings, lane->first_bowler + b, lane->players[b].total_s, !tie && b == best);
+        const PinModel *model = lane->players[b].model;
+        lane->players[b] = Player();
+        lane->players[b].model = model;
+    }
+    lane->frame = 0;
+    --lane->games_left;
+}
+
+/*********************************************************************
+** Function: update_standings
+** Description: Posts one finished game to the shared standings using
+**   atomic adds and a compare-and-swap loop for the high game.
+** Parameters: Standings *standings - the shared league standings.
+**             int id - the bowler's index in the standings.
+**             int total - the game's total score.
+**             bool won - whether the bowler won the game on their lane.
+** Pre-Conditions: id is from 0 to standings->size - 1.
+** Post-Conditions: The bowler's standings include the game.
+** Return: N/A
+*********************************************************************/
+void update_standings(Standings *standings, int id, int total, bool won) {
+    standings->pins[id] += total;
+    ++standings->games[id];
+    if (won)
+        ++standings->wins[id];
+    int high = standings->high[id];
+    while (total > high && !standings->high[id].compare_exchange_weak(high, total)) {}
+}
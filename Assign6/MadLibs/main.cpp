@@ -4,33 +4,168 @@
 ** Date: 03/6/2017
 ** Description: Let's the user play Mad Libs with one of three pre-
 **   programmed stories, selected by passing in a 1, 2, or 3 as the
-**   sole command-line argument. Fills in the story's missing words
-**   randomly with user-supplied words matching the part of speech.
+**   first command-line argument, or with any story of a template file
+**   passed as "--stories <file>". Fills in the story's missing words
+**   randomly with user-supplied words matching the part of speech. An
+**   optional second argument gives the random seed, so that the same
+**   word file produces the same story. "--compile <image>" instead
+**   sorts the word file into a binary bank image, and "--bank <image>"
+**   memory-maps such an image in place of reading a word file, so that
+**   startup takes the same few microseconds whatever the bank's size.
+**   In a template file, stories are separated by lines holding only
+**   "%%", and each blank is marked inline with its part of speech:
+**   {noun}, {plural-noun}, {verb}, {verb-ing}, or {adjective} ("{{" is a
+**   literal brace). "--batch <n>" instead writes n stories of every
+**   template to stdout on "--threads <t>" threads (one per core by
+**   default), each drawing from its own stream of "--seed <s>", and
+**   reports the throughput on stderr.
 ** Input: Pairs consisting of parts of speech and words belonging to
-**   that part of speech, space or newline delimited.
-** Output: Prints out the completed story.
+**   that part of speech, space or newline delimited, on stdin. A word
+**   file redirected to stdin is memory-mapped and parsed in parallel.
+** Output: Prints out the completed story (or stories).
 *********************************************************************/
 
 #include <iostream>
-#include <cstring>      // for strlen(), strcpy()
-#include <cstdlib>      // for rand(), srand()
-#include <ctime>        // for time()
+#include <iomanip>      // for setprecision()
+#include <cstring>      // for memcmp(), memchr(), strcmp()
+#include <cstdio>       // for fopen(), fwrite()
+#include <cstdlib>      // for strtoull(), strtol(), atoll(), realloc(), free()
+#include <vector>       // for vector
+#include <string>       // for string
+#include <fstream>      // for ifstream
+#include <sstream>      // for ostringstream
+#include <thread>       // for thread
+#include <mutex>        // for mutex, lock_guard
+#include <atomic>       // for atomic
+#include <chrono>       // for steady_clock
+#include <stdint.h>     // for uint32_t
+#include <sys/mman.h>   // for mmap(), munmap()
+#include <sys/stat.h>   // for fstat()
+#include <fcntl.h>      // for open()
+#include <unistd.h>     // for read(), write(), close()
+#include <cerrno>       // for errno
+#ifdef __SSE2__
+#include <emmintrin.h>  // for SSE2 intrinsics
+#endif
+#include "../../Common/random.h"
+
+#define NUM_CODES 5
+#define ARENA_START 4096
+#define MIN_CHUNK_SIZE (1 << 20)
+#define BANK_MAGIC 0x4b424c4du      // "MLBK"
+#define BANK_VERSION 1
+#define BATCH_BUFFER (1 << 20)
 
 using namespace std;
 
-void fill_word_bank(char****);
-int get_code(const char*, const char*);
-void add_word(char***, const char*);
-bool assign_words(const int*, char***, char***);
-void print_story(const char[][102], char**);
-void cleanup(char***, char****);
+// Every word of the bank. text is either the whole word file, memory-
+// mapped when stdin is a regular file or read into the arena (which
+// grows by doubling) when it is a pipe, or the string blob of a mapped
+// bank image. The words are never copied out of it; word i of part of
+// speech code c starts at text + words[c][i] and runs up to the next
+// whitespace character. words[c] points to count[c] offsets, held in
+// offsets[c] for a parsed word file or in the mapping for an image.
+struct WordBank {
+    const char *text {};
+    size_t size {};
+    void *map {};
+    size_t map_size {};
+    char *arena {};
+    size_t capacity {};
+    const uint64_t *words[NUM_CODES] {};
+    size_t count[NUM_CODES] {};
+    vector<uint64_t> offsets[NUM_CODES];
+};
+
+// The words one parser thread found in its chunk of the text.
+struct ParsedChunk {
+    vector<uint64_t> offsets[NUM_CODES];
+};
+
+// One step of a compiled story: a literal fragment of the library's
+// text (code -1), or a blank to fill with a word of part of speech code.
+struct StoryOp {
+    int code {};
+    size_t start {};
+    size_t length {};
+};
+
+// A story is the run of num_ops ops starting at first_op, num_blanks of
+// which are blanks.
+struct Story {
+    size_t first_op {};
+    size_t num_ops {};
+    size_t num_blanks {};
+};
+
+// Every story of a template file, compiled into one flat list of ops
+// whose literal fragments all live in text. There is no limit on the
+// number of stories or on the length or number of blanks of any one.
+struct StoryLibrary {
+    string text;
+    vector<StoryOp> ops;
+    vector<Story> stories;
+};
+
+// Where the batch generator's threads write. Each thread fills its own
+// buffer of about BATCH_BUFFER characters and writes it whole under the
+// lock, so stories from different threads never interleave.
+struct BatchOutput {
+    int fd {};
+    mutex lock;
+    atomic<bool> failed {false};
+};
+
+// On-disk layout of a bank image: a BankHeader, then the offset table
+// of each part of speech code in turn (count[c] 64-bit offsets into the
+// blob), then the blob itself, which holds every word followed by a
+// newline.
+struct BankHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count[NUM_CODES];
+    uint64_t blob_size;
+};
+
+void fill_word_bank(WordBank*);
+bool write_bank_image(const char*, const WordBank*);
+bool open_bank_image(const char*, WordBank*);
+const char* find_option(int, char*[], const char*);
+bool load_word_text(int, WordBank*);
+void parse_word_bank(WordBank*, int);
+size_t count_tokens(const char*, const char*);
+void parse_chunk(const char*, const char*, const char*, const char*, bool, ParsedChunk*);
+unsigned space_mask(const char*);
+const char* skip_space(const char*, const char*);
+const char* skip_word(const char*, const char*);
+bool is_space(char);
+int get_code(const char*, size_t, const char*, size_t);
+const char* bank_word(const WordBank*, int, size_t);
+size_t word_length(const WordBank*, const char*);
+bool load_stories(const char*, StoryLibrary*);
+bool compile_stories(const char*, size_t, StoryLibrary*);
+bool is_story_separator(const char*, const char*);
+void add_literal(StoryLibrary*, Story*, const char*, size_t);
+void finish_story(StoryLibrary*, Story*);
+int blank_code(const char*, size_t);
+bool assign_words(const StoryLibrary*, const Story*, const char***, const WordBank*, RandomStream*);
+void print_story(const StoryLibrary*, const Story*, const char**, const WordBank*);
+bool run_batch(const StoryLibrary*, const WordBank*, long long, int, uint64_t);
+void generate_stories(const StoryLibrary*, const WordBank*, long long, long long, long long, RandomStream,
+                      BatchOutput*, long long*);
+void flush_batch(BatchOutput*, string*);
+bool write_all(int, const char*, size_t);
+void cleanup(const char***, WordBank*);
 
 /*********************************************************************
 ** Function: main
-** Description: Checks that the correct number and type of command-line
-**   arguments have been passed in, seeds the random number generator,
-**   defines the story array and the array of parts of speech of the
-**   missing words, calls fill_word_bank() to read in words from the user,
+** Description: Compiles the built-in stories (or loads the template
+**   file), checks that the correct number and type of command-line
+**   arguments have been passed in, creates the random stream,
+**   calls fill_word_bank() to read in words from the user
+**   (or open_bank_image() to map a compiled bank, or, when compiling,
+**   write_bank_image() to save the words and return, or run_batch() to
+**   generate stories in bulk),
 **   calls assign_words() to randomly assign words of the correct part
 **   of speech to the story blanks, calls print_story() to output the
 **   completed story to the console, and calls cleanup() to free all
@@ -38,38 +173,98 @@ void cleanup(char***, char****);
 ** Parameters: int argc - the number of command-line arguments passed in.
 **             char *argv[] - array of C-style strings containing all of
 **               the command-line arguments.
-** Pre-Conditions: argc is 2 and argv[1][0] is '1', '2', or '3'.
+** Pre-Conditions: Besides the options, the arguments are the story
+**   number (from 1 to the number of stories) and optionally the random
+**   seed, unless "--batch" is passed.
 ** Post-Conditions: The completed story has been printed to the console
 **   and all allocated memory on the heap has been freed.
 ** Return: 0
 *********************************************************************/
 int main(int argc, char *argv[]) {
-    if (argc != 2 || (argv[1][0] < '1' || argv[1][0] > '3')) {
-        cout << "Please pass the desired story number (1,2,3) as the sole command-line argument." << endl;
+    const char **blanks = 0;
+    WordBank word_bank;
+    const char *image_path = find_option(argc, argv, "--compile");
+    if (image_path) {
+        fill_word_bank(&word_bank);
+        if (!write_bank_image(image_path, &word_bank))
+            cout << "Could not write the bank image " << image_path << "." << endl;
+        cleanup(&blanks, &word_bank);
+        return 0;
+    }
+
+    StoryLibrary library;
+    const char default_stories[] = "Story 1:\n"
+                                   "\tMost doctors agree that bicycle {verb-ing} is a(n) {adjective} form of exercise.\n"
+                                   "{verb-ing} a bicycle enables you to develop your {noun} muscles, as well as increase\n"
+                                   "the rate of your {noun} beat. More {plural-noun} around the world {verb} bicycles than\n"
+                                   "drive {plural-noun}. No matter what kind of {noun} you {verb}, always be sure to wear a(n)\n"
+                                   "{adjective} helmet. Make sure to have {adjective} reflectors too!\n"
+                                   "%%\n"
+                                   "Story 2:\n"
+                                   "\tYesterday, {noun} and I went to the park. On our way to the {adjective} park,\n"
+                                   "we saw a(n) {adjective} {noun} on a bike. We also saw big {adjective} balloons tied to a(n)\n"
+                                   "{noun}. Once we got to the {adjective} park, the sky turned {adjective}. It started to {verb}\n"
+                                   "and {verb}. {noun} and I {verb} all the way home. Tomorrow we will try to go to the\n"
+                                   "{adjective} park again and hope it doesn't {verb}.\n"
+                                   "%%\n"
+                                   "Story 3:\n"
+                                   "\tSpring break 2017, oh how I have been waiting for you! Spring break is\n"
+                                   "when you go to some {adjective} place to spend time with {noun}. Getting to {noun} is\n"
+                                   "going to take {adjective} hours. My favorite part of spring break is {verb-ing} in the\n"
+                                   "{noun}. During spring break, {noun} and I plan to {verb} all the way to {noun}. After spring\n"
+                                   "break, I will be ready to return to {noun} and {verb} hard to finish {noun}. Thanks\n"
+                                   "spring break 2017!\n";
+    const char *stories_path = find_option(argc, argv, "--stories");
+    if (!stories_path)
+        compile_stories(default_stories, sizeof(default_stories) - 1, &library);
+    else if (!load_stories(stories_path, &library)) {
+        cout << "Could not load the stories in " << stories_path << "." << endl;
+        return 0;
+    }
+
+    const char *batch = find_option(argc, argv, "--batch");
+    const Story *story = 0;
+    RandomStream rng;
+    if (batch && atoll(batch) <= 0) {
+        cout << "Please pass a positive number of stories per template to --batch." << endl;
         return 0;
     }
+    else if (!batch) {
+        const char *args[3] = {};
+        int num_args = 0;
+        for (int i = 1; i < argc; ++i) {
+            if (!strcmp(argv[i], "--bank") || !strcmp(argv[i], "--stories"))
+                ++i;
+            else if (num_args < 3)
+                args[num_args++] = argv[i];
+        }
+        char *end = 0;
+        long story_num = (num_args ? strtol(args[0], &end, 10) : 0);
+        if (num_args < 1 || num_args > 2 || *end || story_num < 1 || story_num > (long)library.stories.size()) {
+            cout << "Please pass the desired story number (1 to " << library.stories.size()
+                 << "), optionally followed by a random seed." << endl;
+            return 0;
+        }
+        rng = make_stream(num_args == 2 ? strtoull(args[1], 0, 10) : time_seed());
+        story = &library.stories[story_num - 1];
+    }
 
-    srand(time(NULL));
-    const int story_num = argv[1][0] - '1';
-    const char story[3][16][102] = {{"Story 1:\n\tMost doctors agree that bicycle ", " is a(n) ", " form of exercise.\n", " a bicycle enables you to develop your ",
-                      " muscles, as well as increase\nthe rate of your ", " beat. More ", " around the world ", " bicycles than\ndrive ",
-                      ". No matter what kind of ", " you ", ", always be sure to wear a(n)\n", " helmet. Make sure to have ", " reflectors too!\n", "\0"},
-                      {"Story 2:\n\tYesterday, ", " and I went to the park. On our way to the ", " park,\nwe saw a(n) ", " ", " on a bike. We also saw big ",
-                      " balloons tied to a(n)\n", ". Once we got to the ", " park, the sky turned ", ". It started to ", "\nand ", ". ", " and I ",
-                      " all the way home. Tomorrow we will try to go to the\n", " park again and hope it doesn't ", ".\n", "\0"},
-                      {"Story 3:\n\tSpring break 2017, oh how I have been waiting for you! Spring break is\nwhen you go to some ", " place to spend time with ",
-                      ". Getting to ", " is\ngoing to take ", " hours. My favorite part of spring break is ", " in the\n", ". During spring break, ",
-                      " and I plan to ", " all the way to ", ". After spring\nbreak, I will be ready to return to ", " and ", " hard to finish ",
-                      ". Thanks\nspring break 2017!\n", "\0"}};
-    const int blank_codes[3][15] = {{3, 4, 3, 0, 0, 1, 2, 1, 0, 2, 4, 4, -1},
-                                   {0, 4, 4, 0, 4, 0, 4, 4, 2, 2, 0, 2, 4, 2, -1},
-                                   {4, 0, 0, 4, 3, 0, 0, 2, 0, 0, 2, 0, -1}};
-    char **blanks = 0, ***word_bank = 0;
-
-    fill_word_bank(&word_bank);
-    if (!assign_words(blank_codes[story_num], &blanks, word_bank))
+    image_path = find_option(argc, argv, "--bank");
+    if (!image_path)
+        fill_word_bank(&word_bank);
+    else if (!open_bank_image(image_path, &word_bank)) {
+        cout << "Could not open the bank image " << image_path << "." << endl;
+        return 0;
+    }
+    if (batch) {
+        const char *threads = find_option(argc, argv, "--threads"), *seed = find_option(argc, argv, "--seed");
+        if (!run_batch(&library, &word_bank, atoll(batch), threads ? atoi(threads) : thread::hardware_concurrency(),
+                       seed ? strtoull(seed, 0, 10) : time_seed()))
+            cout << "Some parts of speech missing." << endl;
+    }
+    else if (!assign_words(&library, story, &blanks, &word_bank, &rng))
         cout << "Some parts of speech missing." << endl;
-    else print_story(story[story_num], blanks);
+    else print_story(&library, story, blanks, &word_bank);
     cleanup(&blanks, &word_bank);
 
     return 0;
@@ -77,89 +272,611 @@ int main(int argc, char *argv[]) {
 
 /*********************************************************************
 ** Function: fill_word_bank
-** Description: Parses the input from the file, allocating memory on the
-**   heap and adding words to the word_bank based on their part of speech
-**   code as determined by get_code().
-** Parameters: char ****word_bank - points to the pointer in the caller
-**               that will point to the array of arrays of C-style strings
-**               created in this function to hold the words from the
-**               supplied word file.
-** Pre-Conditions: N/A
-** Post-Conditions: *word_bank points to a dynamically allocated array of
-**   arrays of C-style strings holding the words from the word file.
+** Description: Loads the word file from stdin and sorts its words into
+**   the word_bank by their part of speech code as determined by
+**   get_code(). Words with an unknown part of speech are skipped.
+** Parameters: WordBank *word_bank - the bank that will hold the words
+**               from the supplied word file.
+** Pre-Conditions: word_bank is empty.
+** Post-Conditions: word_bank holds the words from the word file.
 ** Return: N/A
 *********************************************************************/
-void fill_word_bank(char ****word_bank) {
-    *word_bank = new char**[5];
-    for (int i = 0; i < 5; ++i) {
-        (*word_bank)[i] = new char*;
-        *((*word_bank)[i]) = 0;
+void fill_word_bank(WordBank *word_bank) {
+    if (load_word_text(STDIN_FILENO, word_bank))
+        parse_word_bank(word_bank, thread::hardware_concurrency());
+    for (int c = 0; c < NUM_CODES; ++c) {
+        word_bank->words[c] = word_bank->offsets[c].data();
+        word_bank->count[c] = word_bank->offsets[c].size();
     }
-    char PoS[10], word[30];
-    cin >> PoS >> word;
-    while (!cin.fail()) {
-        int code = get_code(PoS, word);
-        add_word(&(*word_bank)[code], word);
-        cin >> PoS >> word;
+}
+
+/*********************************************************************
+** Function: write_bank_image
+** Description: Saves a bank as a bank image, so that later runs can map
+**   it with open_bank_image instead of parsing and classifying the word
+**   file again. Only the words with a known part of speech are kept.
+** Parameters: const char *path - the image file to create.
+**             const WordBank *word_bank - the bank to save.
+** Pre-Conditions: word_bank was filled by fill_word_bank.
+** Post-Conditions: The image file has been written (or replaced).
+** Return: True if the whole image was written, false otherwise.
+*********************************************************************/
+bool write_bank_image(const char *path, const WordBank *word_bank) {
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return false;
+
+    BankHeader header = {BANK_MAGIC, BANK_VERSION, {}, 0};
+    for (int c = 0; c < NUM_CODES; ++c)
+        header.count[c] = word_bank->count[c];
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (int c = 0; c < NUM_CODES && ok; ++c) {
+        vector<uint64_t> table(word_bank->count[c]);
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = header.blob_size;
+            header.blob_size += word_length(word_bank, bank_word(word_bank, c, i)) + 1;
+        }
+        ok = fwrite(table.data(), sizeof(uint64_t), table.size(), out) == table.size();
+    }
+    for (int c = 0; c < NUM_CODES && ok; ++c)
+        for (size_t i = 0; i < word_bank->count[c] && ok; ++i) {
+            const char *word = bank_word(word_bank, c, i);
+            size_t length = word_length(word_bank, word);
+            ok = fwrite(word, 1, length, out) == length && putc('\n', out) != EOF;
+        }
+
+    // The blob size is only known now.
+    ok = ok && !fseek(out, 0, SEEK_SET) && fwrite(&header, sizeof(header), 1, out) == 1;
+    return !fclose(out) && ok;
+}
+
+/*********************************************************************
+** Function: open_bank_image
+** Description: Memory-maps a bank image written by write_bank_image and
+**   points the bank at its offset tables and blob, so that no word is
+**   read until it is drawn.
+** Parameters: const char *path - the image file.
+**             WordBank *word_bank - the bank to set up.
+** Pre-Conditions: word_bank is empty.
+** Post-Conditions: word_bank holds the image's words.
+** Return: True if the image was mapped and its header and size are
+**   valid, false otherwise.
+*********************************************************************/
+bool open_bank_image(const char *path, WordBank *word_bank) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) || info.st_size < (off_t)sizeof(BankHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *map = mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const BankHeader *header = (const BankHeader*)map;
+    uint64_t size = sizeof(BankHeader), room = info.st_size;
+    for (int c = 0; c < NUM_CODES; ++c) {
+        if (header->count[c] > (room - size) / sizeof(uint64_t)) {
+            munmap(map, info.st_size);
+            return false;
+        }
+        size += header->count[c] * sizeof(uint64_t);
+    }
+    if (header->magic != BANK_MAGIC || header->version != BANK_VERSION
+        || header->blob_size != room - size) {
+        munmap(map, info.st_size);
+        return false;
+    }
+
+    word_bank->map = map;
+    word_bank->map_size = info.st_size;
+    const uint64_t *table = (const uint64_t*)(header + 1);
+    for (int c = 0; c < NUM_CODES; ++c) {
+        word_bank->words[c] = table;
+        word_bank->count[c] = header->count[c];
+        table += header->count[c];
+    }
+    word_bank->text = (const char*)table;
+    word_bank->size = header->blob_size;
+    return true;
+}
+
+/*********************************************************************
+** Function: find_option
+** Description: Searches the command-line arguments for a flag and
+**   returns the argument that immediately follows it.
+** Parameters: int argc - the number of command-line arguments.
+**             char *argv[] - the command-line arguments.
+**             const char *flag - the flag to search for, e.g. "--bank".
+** Pre-Conditions: argv holds argc C-style strings.
+** Post-Conditions: N/A
+** Return: The argument following flag, or a null pointer if the flag
+**   was not passed or has no value after it.
+*********************************************************************/
+const char* find_option(int argc, char *argv[], const char *flag) {
+    for (int i = 1; i < argc - 1; ++i)
+        if (!strcmp(argv[i], flag))
+            return argv[i + 1];
+    return 0;
+}
+
+/*********************************************************************
+** Function: load_word_text
+** Description: Makes the whole word file available as one block of
+**   memory. A regular file is memory-mapped, so that none of it is
+**   copied; anything else (a pipe or a terminal) is read to its end
+**   into the arena.
+** Parameters: int fd - the word file.
+**             WordBank *word_bank - the bank that will own the text.
+** Pre-Conditions: word_bank is empty.
+** Post-Conditions: word_bank->text holds word_bank->size characters.
+** Return: True if there is any text, false otherwise.
+*********************************************************************/
+bool load_word_text(int fd, WordBank *word_bank) {
+    struct stat info;
+    if (!fstat(fd, &info) && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void *map = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, info.st_size, MADV_SEQUENTIAL);
+            word_bank->map = map;
+            word_bank->map_size = info.st_size;
+            word_bank->text = (const char*)map;
+            word_bank->size = info.st_size;
+            return true;
+        }
+    }
+
+    size_t used = 0;
+    while (1) {
+        if (used == word_bank->capacity) {
+            size_t capacity = (word_bank->capacity ? 2 * word_bank->capacity : ARENA_START);
+            char *arena = (char*)realloc(word_bank->arena, capacity);
+            if (!arena)
+                throw bad_alloc();
+            word_bank->arena = arena;
+            word_bank->capacity = capacity;
+        }
+        ssize_t n = read(fd, word_bank->arena + used, word_bank->capacity - used);
+        if (n <= 0)
+            break;
+        used += n;
+    }
+    word_bank->text = word_bank->arena;
+    word_bank->size = used;
+    return used > 0;
+}
+
+/*********************************************************************
+** Function: parse_word_bank
+** Description: Splits the text into one chunk per thread at whitespace
+**   and parses the chunks in parallel, in two passes. The first counts
+**   the tokens of each chunk, which tells each chunk whether it starts
+**   in the middle of a part of speech and word pair; the second reads
+**   the pairs. The chunks' words are then joined in file order, so the
+**   bank is the same whatever the number of threads.
+** Parameters: WordBank *word_bank - the bank, with its text loaded.
+**             int threads - the most threads to parse with. Small files
+**               use fewer, so that every chunk is at least
+**               MIN_CHUNK_SIZE characters.
+** Pre-Conditions: word_bank has no words yet.
+** Post-Conditions: word_bank holds every word of its text.
+** Return: N/A
+*********************************************************************/
+void parse_word_bank(WordBank *word_bank, int threads) {
+    const char *text = word_bank->text, *end = text + word_bank->size;
+    threads = max(1, min(threads, (int)(word_bank->size / MIN_CHUNK_SIZE)));
+    vector<const char*> bounds(1, text);
+    for (int t = 1; t < threads; ++t)
+        bounds.push_back(skip_word(max(text + word_bank->size * t / threads, bounds.back()), end));
+    bounds.push_back(end);
+
+    // tokens[t] is the number of tokens in the chunk before chunk t.
+    vector<size_t> tokens(threads);
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t)
+        workers.push_back(thread([&bounds, &tokens, t]() { tokens[t] = count_tokens(bounds[t - 1], bounds[t]); }));
+    for (int t = 1; t < threads; ++t)
+        workers[t - 1].join();
+    workers.clear();
+
+    // A chunk that follows an odd number of tokens starts with the word
+    // of a pair whose part of speech ended the chunk before.
+    vector<ParsedChunk> chunks(threads);
+    size_t before = 0;
+    for (int t = 0; t < threads; ++t) {
+        before += tokens[t];
+        workers.push_back(thread(parse_chunk, text, end, bounds[t], bounds[t + 1], (bool)(before % 2), &chunks[t]));
+    }
+    for (int t = 0; t < threads; ++t)
+        workers[t].join();
+
+    for (int c = 0; c < NUM_CODES; ++c) {
+        size_t total = 0;
+        for (int t = 0; t < threads; ++t)
+            total += chunks[t].offsets[c].size();
+        word_bank->offsets[c].reserve(total);
+        for (int t = 0; t < threads; ++t) {
+            word_bank->offsets[c].insert(word_bank->offsets[c].end(), chunks[t].offsets[c].begin(),
+                                         chunks[t].offsets[c].end());
+            vector<uint64_t>().swap(chunks[t].offsets[c]);
+        }
+    }
+}
+
+/*********************************************************************
+** Function: count_tokens
+** Description: Counts the whitespace-separated tokens of a chunk of
+**   text, sixteen characters at a time where SSE2 is available: a token
+**   starts at every non-space character that follows a space.
+** Parameters: const char *begin - the first character of the chunk.
+**             const char *end - one past the last character.
+** Pre-Conditions: The chunk does not start in the middle of a token.
+** Post-Conditions: N/A
+** Return: The number of tokens that start in the chunk.
+*********************************************************************/
+size_t count_tokens(const char *begin, const char *end) {
+    size_t count = 0;
+    unsigned after_space = 1;
+    const char *p = begin;
+#ifdef __SSE2__
+    for (; end - p >= 16; p += 16) {
+        unsigned spaces = space_mask(p);
+        count += __builtin_popcount(~spaces & ((spaces << 1) | after_space) & 0xFFFF);
+        after_space = spaces >> 15;
+    }
+#endif
+    for (; p < end; ++p) {
+        bool space = is_space(*p);
+        count += (!space && after_space);
+        after_space = space;
+    }
+    return count;
+}
+
+/*********************************************************************
+** Function: parse_chunk
+** Description: Thread body for parse_word_bank. Reads the part of
+**   speech and word pairs that start in a chunk of the text, following
+**   the last pair's word into the next chunk if need be, and records the
+**   offset of every word whose part of speech is known.
+** Parameters: const char *text - the start of the whole text.
+**             const char *text_end - one past its last character.
+**             const char *begin - the first character of the chunk.
+**             const char *end - one past the last character.
+**             bool odd - whether the chunk starts with the word of a pair
+**               begun in the chunk before.
+**             ParsedChunk *chunk - where the chunk's words are stored.
+** Pre-Conditions: The chunk does not start in the middle of a token and
+**   no other thread writes to chunk.
+** Post-Conditions: chunk holds the offsets of the chunk's words, in
+**   order. A part of speech left without a word at the end of the text
+**   is ignored.
+** Return: N/A
+*********************************************************************/
+void parse_chunk(const char *text, const char *text_end, const char *begin, const char *end, bool odd,
+                 ParsedChunk *chunk) {
+    const char *p = skip_space(begin, end);
+    if (odd)
+        p = skip_space(skip_word(p, end), end);
+    while (p < end) {
+        const char *pos_end = skip_word(p, end);
+        const char *word = skip_space(pos_end, text_end), *word_end = skip_word(word, text_end);
+        if (word == text_end)
+            break;
+        int code = get_code(p, pos_end - p, word, word_end - word);
+        if (code >= 0)
+            chunk->offsets[code].push_back(word - text);
+        p = skip_space(word_end, end);
+    }
+}
+
+/*********************************************************************
+** Function: space_mask
+** Description: Classifies sixteen characters at once.
+** Parameters: const char *p - the first of the characters.
+** Pre-Conditions: SSE2 is available and p has sixteen readable
+**   characters.
+** Post-Conditions: N/A
+** Return: A mask with bit i set if p[i] is whitespace.
+*********************************************************************/
+unsigned space_mask(const char *p) {
+#ifdef __SSE2__
+    __m128i c = _mm_loadu_si128((const __m128i*)p);
+    __m128i controls = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1)));
+    return _mm_movemask_epi8(_mm_or_si128(controls, _mm_cmpeq_epi8(c, _mm_set1_epi8(' '))));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < 16; ++i)
+        mask |= (unsigned)is_space(p[i]) << i;
+    return mask;
+#endif
+}
+
+/*********************************************************************
+** Function: skip_space
+** Description: Finds the first non-whitespace character at or after p.
+** Parameters: const char *p - where to start.
+**             const char *end - where to stop.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The first non-whitespace character, or end if there is none
+**   before it (or p if p is already past end).
+*********************************************************************/
+const char* skip_space(const char *p, const char *end) {
+#ifdef __SSE2__
+    for (; end - p >= 16; p += 16) {
+        unsigned others = ~space_mask(p) & 0xFFFF;
+        if (others)
+            return p + __builtin_ctz(others);
     }
+#endif
+    while (p < end && is_space(*p))
+        ++p;
+    return p;
+}
+
+/*********************************************************************
+** Function: skip_word
+** Description: Finds the first whitespace character at or after p.
+** Parameters: const char *p - where to start.
+**             const char *end - where to stop.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The first whitespace character, or end if there is none
+**   before it (or p if p is already past end).
+*********************************************************************/
+const char* skip_word(const char *p, const char *end) {
+#ifdef __SSE2__
+    for (; end - p >= 16; p += 16) {
+        unsigned spaces = space_mask(p);
+        if (spaces)
+            return p + __builtin_ctz(spaces);
+    }
+#endif
+    while (p < end && !is_space(*p))
+        ++p;
+    return p;
+}
+
+/*********************************************************************
+** Function: is_space
+** Description: Checks for the whitespace characters that separate the
+**   tokens of a word file (the same ones cin skips).
+** Parameters: char c - the character.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if c is a space, tab, newline, vertical tab, form feed,
+**   or carriage return.
+*********************************************************************/
+bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
 }
 
 /*********************************************************************
 ** Function: get_code
 ** Description: Determines the part of speech code of the word based on
 **   the part of speech label and word ending.
-** Parameters: const char *PoS - C-style string containing the part of
-**               speech label.
-**             const char *word - C-style string containing the word
-**               itself.
-** Pre-Conditions: PoS and word point to C-style strings.
+** Parameters: const char *PoS - the part of speech label.
+**             size_t pos_length - the length of the label.
+**             const char *word - the word itself.
+**             size_t length - the length of the word.
+** Pre-Conditions: PoS and word point to at least pos_length and length
+**   characters, and length is positive.
 ** Post-Conditions: N/A
 ** Return: Returns the part of speech code of the word. If no match is
 **   found, returns -1.
 *********************************************************************/
-int get_code(const char *PoS, const char *word) {
-    int len = strlen(word);
-    if (!strcmp(PoS, "noun")) {
-        if (word[len - 1] == 's')
+int get_code(const char *PoS, size_t pos_length, const char *word, size_t length) {
+    if (pos_length == 4 && !memcmp(PoS, "noun", 4)) {
+        if (word[length - 1] == 's')
             return 1; //plural noun
         return 0; //singular noun
     }
-    if (!strcmp(PoS, "verb")) {
-        if (word[len - 3] == 'i' && word[len - 2] == 'n' && word[len - 1] == 'g')
+    if (pos_length == 4 && !memcmp(PoS, "verb", 4)) {
+        if (length >= 3 && !memcmp(word + length - 3, "ing", 3))
             return 3; //-ing verb
         return 2; //verb
     }
-    if (!strcmp(PoS, "adjective"))
+    if (pos_length == 9 && !memcmp(PoS, "adjective", 9))
         return 4; // adjective
     return -1;
 }
 
 /*********************************************************************
-** Function: add_word
-** Description: Allocates memory for an additional word in the word_list
-**   array. Handles deallocation of the old, shorter array.
-** Parameters: char ***word_list - points to a pointer in the caller that
-**               points to the array of C-style strings containing the
-**               words of a particular part of speech.
-**             const char *word - C-style string containing the word
-**               itself.
-** Pre-Conditions: The part of speech of *word_list and word match.
-**   *word_list is terminated with a null pointer.
-** Post-Conditions: word has been added to *word_list. *word_list has
-**   been increased in size by one, and is still null terminated.
+** Function: bank_word
+** Description: Finds a word of the bank.
+** Parameters: const WordBank *word_bank - the bank.
+**             int code - the part of speech code.
+**             size_t i - which word of that part of speech.
+** Pre-Conditions: i is less than word_bank->count[code].
+** Post-Conditions: N/A
+** Return: A pointer to the word inside the bank's text, valid until the
+**   bank is cleaned up. The word is not null-terminated; see
+**   word_length. An offset past the end of the text, which only a
+**   corrupt bank image can hold, gives an empty word at the end of the
+**   text instead.
+*********************************************************************/
+const char* bank_word(const WordBank *word_bank, int code, size_t i) {
+    uint64_t offset = word_bank->words[code][i];
+    return word_bank->text + (offset < word_bank->size ? offset : word_bank->size);
+}
+
+/*********************************************************************
+** Function: word_length
+** Description: Measures a word of the bank, which runs up to the next
+**   whitespace character or the end of the text.
+** Parameters: const WordBank *word_bank - the bank.
+**             const char *word - a word returned by bank_word.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The number of characters in the word.
+*********************************************************************/
+size_t word_length(const WordBank *word_bank, const char *word) {
+    return skip_word(word, word_bank->text + word_bank->size) - word;
+}
+
+/*********************************************************************
+** Function: load_stories
+** Description: Reads a template file and compiles its stories.
+** Parameters: const char *path - the template file.
+**             StoryLibrary *library - the library to compile into.
+** Pre-Conditions: library is empty.
+** Post-Conditions: library holds the file's stories if it was valid.
+** Return: True if the file was read and compiled and has at least one
+**   story, false otherwise.
+*********************************************************************/
+bool load_stories(const char *path, StoryLibrary *library) {
+    ifstream in(path, ios::binary);
+    if (!in)
+        return false;
+    ostringstream source;
+    source << in.rdbuf();
+    string text = source.str();
+    return compile_stories(text.data(), text.size(), library) && !library->stories.empty();
+}
+
+/*********************************************************************
+** Function: compile_stories
+** Description: Compiles template text into a library, once, so that
+**   telling a story is a walk over a flat list of literal fragments and
+**   blanks. Stories are separated by lines holding only "%%", and a
+**   blank is its part of speech between braces, e.g. {verb-ing}; "{{"
+**   stands for a literal brace. Adjacent literal text is merged into a
+**   single fragment.
+** Parameters: const char *source - the template text.
+**             size_t size - the length of the text.
+**             StoryLibrary *library - the library to compile into.
+** Pre-Conditions: N/A
+** Post-Conditions: The text's stories have been appended to library.
+**   Stories with no text at all are left out.
+** Return: True if every blank was valid, or false at the first blank
+**   that is unterminated or names an unknown part of speech.
+*********************************************************************/
+bool compile_stories(const char *source, size_t size, StoryLibrary *library) {
+    const char *p = source, *end = source + size;
+    Story story;
+    story.first_op = library->ops.size();
+    while (p < end) {
+        const char *line_end = (const char*)memchr(p, '\n', end - p);
+        line_end = (line_end ? line_end + 1 : end);
+        if (is_story_separator(p, line_end)) {
+            finish_story(library, &story);
+            p = line_end;
+            continue;
+        }
+        while (p < line_end) {
+            const char *brace = (const char*)memchr(p, '{', line_end - p);
+            if (!brace)
+                brace = line_end;
+            add_literal(library, &story, p, brace - p);
+            if (brace == line_end)
+                break;
+            if (brace + 1 < line_end && brace[1] == '{') {
+                add_literal(library, &story, brace, 1);
+                p = brace + 2;
+                continue;
+            }
+            const char *close = (const char*)memchr(brace, '}', line_end - brace);
+            int code = (close ? blank_code(brace + 1, close - brace - 1) : -1);
+            if (code < 0)
+                return false;
+            StoryOp op;
+            op.code = code;
+            library->ops.push_back(op);
+            ++story.num_blanks;
+            p = close + 1;
+        }
+        p = line_end;
+    }
+    finish_story(library, &story);
+    return true;
+}
+
+/*********************************************************************
+** Function: is_story_separator
+** Description: Checks whether a line of template text separates two
+**   stories.
+** Parameters: const char *line - the first character of the line.
+**             const char *line_end - one past its last character,
+**               including its newline if it has one.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if the line is "%%" followed only by its line ending.
+*********************************************************************/
+bool is_story_separator(const char *line, const char *line_end) {
+    if (line_end - line < 2 || line[0] != '%' || line[1] != '%')
+        return false;
+    for (const char *c = line + 2; c < line_end; ++c)
+        if (*c != '\r' && *c != '\n')
+            return false;
+    return true;
+}
+
+/*********************************************************************
+** Function: add_literal
+** Description: Appends literal text to the story being compiled,
+**   extending its last fragment when that ends where the new text
+**   starts in the library's text.
+** Parameters: StoryLibrary *library - the library being compiled.
+**             Story *story - the story being compiled.
+**             const char *text - the literal text.
+**             size_t length - its length.
+** Pre-Conditions: story is the library's last, unfinished story.
+** Post-Conditions: The text has been copied to the library.
+** Return: N/A
+*********************************************************************/
+void add_literal(StoryLibrary *library, Story *story, const char *text, size_t length) {
+    if (!length)
+        return;
+    if (library->ops.size() > story->first_op && library->ops.back().code < 0
+        && library->ops.back().start + library->ops.back().length == library->text.size())
+        library->ops.back().length += length;
+    else {
+        StoryOp op;
+        op.code = -1;
+        op.start = library->text.size();
+        op.length = length;
+        library->ops.push_back(op);
+    }
+    library->text.append(text, length);
+}
+
+/*********************************************************************
+** Function: finish_story
+** Description: Ends the story being compiled and starts the next.
+** Parameters: StoryLibrary *library - the library being compiled.
+**             Story *story - the story being compiled.
+** Pre-Conditions: story is the library's last, unfinished story.
+** Post-Conditions: The story has been added to the library unless it
+**   has no ops, and story is empty and starts after it.
 ** Return: N/A
 *********************************************************************/
-void add_word(char ***word_list, const char *word) {
-    char **temp = *word_list;
-    int list_size = -1;
-    while ((*word_list)[++list_size]) {}
-    *word_list = new char*[list_size + 2];
-    for (int i = 0; i < list_size; ++i)
-        (*word_list)[i] = temp[i];
-    (*word_list)[list_size] = new char[strlen(word) + 1];
-    strcpy((*word_list)[list_size], word);
-    (*word_list)[list_size + 1] = 0;
-    delete[] temp;
+void finish_story(StoryLibrary *library, Story *story) {
+    story->num_ops = library->ops.size() - story->first_op;
+    if (story->num_ops)
+        library->stories.push_back(*story);
+    *story = Story();
+    story->first_op = library->ops.size();
+}
+
+/*********************************************************************
+** Function: blank_code
+** Description: Looks up the part of speech named by a blank marker.
+** Parameters: const char *name - the name between the braces.
+**             size_t length - the length of the name.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The part of speech code, or -1 if the name is unknown.
+*********************************************************************/
+int blank_code(const char *name, size_t length) {
+    const char *names[NUM_CODES] = {"noun", "plural-noun", "verb", "verb-ing", "adjective"};
+    for (int c = 0; c < NUM_CODES; ++c)
+        if (strlen(names[c]) == length && !memcmp(name, names[c], length))
+            return c;
+    return -1;
 }
 
 /*********************************************************************
@@ -168,31 +885,30 @@ void add_word(char ***word_list, const char *word) {
 **   pointers that will randomly be assigned to words from the word
 **   bank that match the part of speech of each missing word in the
 **   story.
-** Parameters: const int *blank_codes - an array of the part of speech
-**               codes of the required missing words.
-**             char ***blanks - points to the pointer in the caller that
-**               will point to the array of missing words that will be
-**               created in this function.
-**             char ***word_bank - points to the array of arrays of
-**               C-style strings holding the words from the word file.
-** Pre-Conditions: blank_codes points to an integer array terminated by
-**   -1. word_bank points to an array of five C-style string arrays that
-**   are terminated with a null C-style string.
+** Parameters: const StoryLibrary *library - the compiled stories.
+**             const Story *story - the story to fill in.
+**             const char ***blanks - points to the pointer in the caller
+**               that will point to the array of missing words that will
+**               be created in this function.
+**             const WordBank *word_bank - the words from the word file.
+**             RandomStream *rng - the stream the words are drawn with.
+** Pre-Conditions: story is one of the library's stories.
 ** Post-Conditions: *blanks points to a dynamically allocated array of
-**   C-style strings holding the missing words for the story.
+**   the missing words for the story, in order.
 ** Return: Returns false if there were no words in the word_bank for one
 **   of the necessary parts of speech. Returns true if successful.
 *********************************************************************/
-bool assign_words(const int *blank_codes, char ***blanks, char ***word_bank) {
-    int num_words = -1;
-    while (blank_codes[++num_words] != -1) {}
-    *blanks = new char*[num_words];
-    for (int i = 0; i < num_words; ++i) {
-        int num_in_bank = -1;
-        while (word_bank[blank_codes[i]][++num_in_bank]) {}
+bool assign_words(const StoryLibrary *library, const Story *story, const char ***blanks, const WordBank *word_bank,
+                  RandomStream *rng) {
+    const StoryOp *ops = library->ops.data() + story->first_op;
+    *blanks = new const char*[story->num_blanks];
+    for (size_t i = 0, b = 0; i < story->num_ops; ++i) {
+        if (ops[i].code < 0)
+            continue;
+        size_t num_in_bank = word_bank->count[ops[i].code];
         if (!num_in_bank)
             return false;
-        (*blanks)[i] = word_bank[blank_codes[i]][rand() % num_in_bank];
+        (*blanks)[b++] = bank_word(word_bank, ops[i].code, random_below(rng, num_in_bank));
     }
     return true;
 }
@@ -201,55 +917,197 @@ bool assign_words(const int *blank_codes, char ***blanks, char ***word_bank) {
 ** Function: print_story
 ** Description: Prints the story, complete with the missing words
 **   supplied by the user.
-** Parameters: const char story[][102] - the array of C-style strings
-**               holding the paragraph fragments between the missing
-**               words.
-**             char **blanks - points to the array of C-style strings
-**               holding the words selected to fill in the blanks in
-**               the story.
-** Pre-Conditions: the story array is terminated with a C-style string
-**   consisting only of the null terminator character. The length of
-**   blanks is two less than the length of story (including the
-**   aforementioned terminating element).
+** Parameters: const StoryLibrary *library - the compiled stories.
+**             const Story *story - the story to print.
+**             const char **blanks - points to the array of the words
+**               selected to fill in the blanks in the story.
+**             const WordBank *word_bank - the bank the words are in.
+** Pre-Conditions: blanks holds story->num_blanks words, as chosen by
+**   assign_words.
 ** Post-Conditions: The completed story has been printed to the console.
 ** Return: N/A
 *********************************************************************/
-void print_story(const char story[][102], char **blanks) {
-    int i = 0;
+void print_story(const StoryLibrary *library, const Story *story, const char **blanks, const WordBank *word_bank) {
+    const StoryOp *ops = library->ops.data() + story->first_op;
     cout << endl;
-    while (story[i + 1][0]) {
-        cout << story[i] << blanks[i];
-        ++i;
+    for (size_t i = 0, b = 0; i < story->num_ops; ++i) {
+        if (ops[i].code < 0)
+            cout.write(library->text.data() + ops[i].start, ops[i].length);
+        else {
+            cout.write(blanks[b], word_length(word_bank, blanks[b]));
+            ++b;
+        }
+    }
+    cout << endl;
+}
+
+/*********************************************************************
+** Function: run_batch
+** Description: Generates per_story copies of every story of the
+**   library, each with its own random words, and writes them to stdout
+**   in the same format as print_story. The copies are split evenly over
+**   the threads, each drawing from its own stream of the seed, and the
+**   throughput is reported on stderr.
+** Parameters: const StoryLibrary *library - the compiled stories.
+**             const WordBank *word_bank - the words to fill them with.
+**             long long per_story - the number of copies of each story.
+**             int threads - the number of worker threads to use.
+**             uint64_t seed - the run's seed.
+** Pre-Conditions: per_story is positive.
+** Post-Conditions: The stories have been written, unless a part of
+**   speech is missing.
+** Return: False if the bank has no words for a part of speech some
+**   story needs, true otherwise.
+*********************************************************************/
+bool run_batch(const StoryLibrary *library, const WordBank *word_bank, long long per_story, int threads, uint64_t seed) {
+    for (size_t i = 0; i < library->ops.size(); ++i)
+        if (library->ops[i].code >= 0 && !word_bank->count[library->ops[i].code])
+            return false;
+
+    long long total = per_story * library->stories.size();
+    threads = max(1LL, min((long long)threads, total));
+    BatchOutput output;
+    output.fd = STDOUT_FILENO;
+    cout.flush();
+    vector<long long> bytes(threads);
+    vector<thread> workers;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+        workers.push_back(thread(generate_stories, library, word_bank, total * i / threads, total * (i + 1) / threads,
+                                 per_story, make_stream(seed, i), &output, &bytes[i]));
+    for (int i = 0; i < threads; ++i)
+        workers[i].join();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    long long written = 0;
+    for (int i = 0; i < threads; ++i)
+        written += bytes[i];
+    double seconds = (elapsed.count() > 0 ? elapsed.count() : 1e-9);
+    cerr << (output.failed ? "Output failed after " : "Generated ") << total << " stories (" << fixed << setprecision(1)
+         << written / 1048576.0 << " MB) on " << threads << " thread(s) in " << setprecision(3) << seconds << " s: "
+         << setprecision(0) << total / seconds << " stories/s, " << setprecision(1) << written / 1048576.0 / seconds
+         << " MB/s" << endl;
+    return true;
+}
+
+/*********************************************************************
+** Function: generate_stories
+** Description: Thread body for run_batch. Writes the stories numbered
+**   first to last - 1 of the batch, where story j is a copy of the
+**   library's story j / per_story, straight from the compiled ops into
+**   a large buffer that is written out whenever it fills.
+** Parameters: const StoryLibrary *library - the compiled stories.
+**             const WordBank *word_bank - the words to fill them with.
+**             long long first - the first story of this thread's share.
+**             long long last - one past its last story.
+**             long long per_story - the number of copies of each story.
+**             RandomStream rng - this thread's stream.
+**             BatchOutput *output - where the stories are written.
+**             long long *bytes - receives the number of characters
+**               generated.
+** Pre-Conditions: The bank has words for every part of speech the
+**   stories need.
+** Post-Conditions: The share has been written, unless the output failed.
+** Return: N/A
+*********************************************************************/
+void generate_stories(const StoryLibrary *library, const WordBank *word_bank, long long first, long long last,
+                      long long per_story, RandomStream rng, BatchOutput *output, long long *bytes) {
+    string out;
+    out.reserve(2 * BATCH_BUFFER);
+    *bytes = 0;
+    for (long long j = first; j < last && !output->failed; ++j) {
+        const Story *story = &library->stories[j / per_story];
+        const StoryOp *ops = library->ops.data() + story->first_op;
+        out += '\n';
+        for (size_t i = 0; i < story->num_ops; ++i) {
+            if (ops[i].code < 0)
+                out.append(library->text.data() + ops[i].start, ops[i].length);
+            else {
+                const char *word = bank_word(word_bank, ops[i].code, random_below(&rng, word_bank->count[ops[i].code]));
+                out.append(word, word_length(word_bank, word));
+            }
+        }
+        out += '\n';
+        if (out.size() >= BATCH_BUFFER) {
+            *bytes += out.size();
+            flush_batch(output, &out);
+        }
     }
-    cout << story[i] << endl;
+    *bytes += out.size();
+    flush_batch(output, &out);
+}
+
+/*********************************************************************
+** Function: flush_batch
+** Description: Writes a thread's buffered stories to the batch output
+**   in one piece and empties the buffer.
+** Parameters: BatchOutput *output - the batch output.
+**             string *out - the thread's buffer.
+** Pre-Conditions: out holds whole stories.
+** Post-Conditions: out is empty; output->failed is set if the write
+**   failed.
+** Return: N/A
+*********************************************************************/
+void flush_batch(BatchOutput *output, string *out) {
+    if (out->empty())
+        return;
+    lock_guard<mutex> guard(output->lock);
+    if (!output->failed && !write_all(output->fd, out->data(), out->size()))
+        output->failed = true;
+    out->clear();
+}
+
+/*********************************************************************
+** Function: write_all
+** Description: Writes a block of characters to a file descriptor,
+**   retrying after interrupted and partial writes.
+** Parameters: int fd - the file descriptor.
+**             const char *data - the characters.
+**             size_t size - how many there are.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: True if every character was written, false otherwise.
+*********************************************************************/
+bool write_all(int fd, const char *data, size_t size) {
+    while (size) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
 }
 
 /*********************************************************************
 ** Function: cleanup
-** Description: Frees the memory occupied on the heap by the arrays of
-**   words from the word file.
-** Parameters: char ***blanks - points to the pointer in the caller that
-**               points to the array of C-style strings holding the
+** Description: Releases the word file's text or the bank image, which
+**   is a single mapping or block however many words there are, and
+**   frees the array of selected words.
+** Parameters: const char ***blanks - points to the pointer in the caller
+**               that points to the array of C-style strings holding the
 **               words selected to fill in the blanks in the story.
-**             char ****word_bank - points to the pointer in the caller
-**               that points to the array of arrays of C-style strings
-**               holding the words from the supplied word file.
-** Pre-Conditions: *word_bank points to an array of five C-style string
-**   arrays that are terminated with a null pointer
-** Post-Conditions: All memory occupied for word storage has been freed.
+**             WordBank *word_bank - the words from the word file.
+** Pre-Conditions: N/A
+** Post-Conditions: All memory occupied for word storage has been freed,
+**   and word_bank is empty.
 ** Return: N/A
 *********************************************************************/
-void cleanup(char ***blanks, char ****word_bank) {
-    for (int i = 0; i < 5; ++i) {
-        for (int j = 0; (*word_bank)[i][j]; ++j) {
-            delete[] (*word_bank)[i][j];
-            (*word_bank)[i][j] = 0;
-        }
-        delete[] (*word_bank)[i];
-        (*word_bank)[i] = 0;
+void cleanup(const char ***blanks, WordBank *word_bank) {
+    if (word_bank->map)
+        munmap(word_bank->map, word_bank->map_size);
+    free(word_bank->arena);
+    word_bank->map = 0;
+    word_bank->arena = 0;
+    word_bank->text = 0;
+    word_bank->size = word_bank->map_size = word_bank->capacity = 0;
+    for (int i = 0; i < NUM_CODES; ++i) {
+        word_bank->words[i] = 0;
+        word_bank->count[i] = 0;
+        vector<uint64_t>().swap(word_bank->offsets[i]);
     }
-    delete[] *word_bank;
-    *word_bank = 0;
     delete[] *blanks;
     *blanks = 0;
 }
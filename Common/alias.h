@@ -0,0 +1,94 @@
+/*********************************************************************
+** Program Filename: alias.h
+** Author: Thomas Hollenberg
+** Date: 03/24/2017
+** Description: Walker/Vose alias tables, shared by the game programs
+**   for drawing from a fixed discrete distribution (pins knocked down,
+**   wheel wedges) in constant time, however many outcomes it has. A
+**   table of n outcomes is two arrays of n entries: column k keeps its
+**   own outcome with probability threshold[k] / 2^32 and otherwise
+**   yields alias[k].
+** Input: N/A
+** Output: N/A
+*********************************************************************/
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>     // for uint32_t, uint64_t
+#include <vector>       // for vector
+#include "random.h"
+
+/*********************************************************************
+** Function: build_alias_table
+** Description: Builds the alias table of a distribution by pairing each
+**   outcome that is less likely than average with one that is more
+**   likely, so that every column is filled exactly once.
+** Parameters: const double *p - the probability of each outcome.
+**             int n - the number of outcomes.
+**             uint32_t *threshold - receives n thresholds.
+**             Index *alias - receives n aliases; any integer type that
+**               can hold n - 1.
+** Pre-Conditions: n is positive and p sums to 1.
+** Post-Conditions: threshold and alias describe p.
+** Return: N/A
+*********************************************************************/
+template <class Index>
+void build_alias_table(const double *p, int n, uint32_t *threshold, Index *alias) {
+    std::vector<int> small, large;
+    std::vector<double> scaled(n);
+    for (int k = 0; k < n; ++k) {
+        scaled[k] = p[k] * n;
+        alias[k] = k;
+        if (scaled[k] < 1)
+            small.push_back(k);
+        else large.push_back(k);
+    }
+    while (!small.empty() && !large.empty()) {
+        int s = small.back(), l = large.back();
+        small.pop_back();
+        large.pop_back();
+        threshold[s] = scaled[s] * 4294967295.0;
+        alias[s] = l;
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1)
+            small.push_back(l);
+        else large.push_back(l);
+    }
+    // Whatever is left over (including rounding leftovers) keeps its own
+    // outcome every time.
+    while (!large.empty()) {
+        threshold[large.back()] = 4294967295u;
+        large.pop_back();
+    }
+    while (!small.empty()) {
+        threshold[small.back()] = 4294967295u;
+        small.pop_back();
+    }
+}
+
+/*********************************************************************
+** Function: sample_alias
+** Description: Draws an outcome from an alias table using a single
+**   32-bit random number: the high half of its product with the table
+**   size picks a column and the low half decides between the column and
+**   its alias.
+** Parameters: RandomStream *s - the stream to draw from.
+**             int n - the number of outcomes.
+**             const uint32_t *threshold - the table's thresholds.
+**             const Index *alias - the table's aliases.
+** Pre-Conditions: The table was built by build_alias_table with n
+**   outcomes.
+** Post-Conditions: The stream has advanced by one value.
+** Return: An outcome from 0 to n - 1.
+*********************************************************************/
+template <class Index>
+inline int sample_alias(RandomStream *s, int n, const uint32_t *threshold, const Index *alias) {
+    uint64_t x = (uint64_t)random_u32(s) * n;
+    int column = x >> 32;
+    if ((uint32_t)x < threshold[column])
+        return column;
+    return alias[column];
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*********************************************************************
+** Program Filename: random.h
+** Author: Thomas Hollenberg
+** Date: 03/20/2017
+** Description: Counter-based random number streams shared by the game
+**   programs. A stream is a 64-bit key plus a counter, and each output
+**   is a mix of the two, so a stream is tiny, needs no global state,
+**   can be copied or stored anywhere, and always gives the same values
+**   for the same seed. Independent streams for threads, lanes, or
+**   games are derived from one seed with make_stream().
+** Input: N/A
+** Output: N/A
+*********************************************************************/
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>     // for uint32_t, uint64_t
+#include <ctime>        // for time(), clock()
+
+#define RANDOM_GOLDEN 0x9e3779b97f4a7c15ULL
+
+struct RandomStream {
+    uint64_t key;
+    uint64_t counter;
+};
+
+/*********************************************************************
+** Function: random_mix
+** Description: Scrambles a 64-bit value so that nearby inputs give
+**   unrelated outputs (the SplitMix64 finalizer).
+** Parameters: uint64_t z - the value to be scrambled.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: The scrambled value.
+*********************************************************************/
+inline uint64_t random_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*********************************************************************
+** Function: make_stream
+** Description: Creates stream number stream_id of the given seed.
+**   Different ids give independent streams, so a program can hand one
+**   to each thread (or lane, or game) and still reproduce a run from
+**   the seed alone.
+** Parameters: uint64_t seed - the run's seed.
+**             uint64_t stream_id - which stream of that seed to create.
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: A stream positioned at its first value.
+*********************************************************************/
+inline RandomStream make_stream(uint64_t seed, uint64_t stream_id = 0) {
+    RandomStream s;
+    s.key = random_mix(random_mix(seed) + stream_id * RANDOM_GOLDEN);
+    s.counter = 0;
+    return s;
+}
+
+/*********************************************************************
+** Function: random_u64
+** Description: Returns the next 64 random bits of a stream.
+** Parameters: RandomStream *s - the stream.
+** Pre-Conditions: s was created by make_stream.
+** Post-Conditions: The stream has advanced by one value.
+** Return: A uniformly distributed 64-bit value.
+*********************************************************************/
+inline uint64_t random_u64(RandomStream *s) {
+    return random_mix(s->key + ++s->counter * RANDOM_GOLDEN);
+}
+
+/*********************************************************************
+** Function: random_u32
+** Description: Returns the next 32 random bits of a stream.
+** Parameters: RandomStream *s - the stream.
+** Pre-Conditions: s was created by make_stream.
+** Post-Conditions: The stream has advanced by one value.
+** Return: A uniformly distributed 32-bit value.
+*********************************************************************/
+inline uint32_t random_u32(RandomStream *s) {
+    return random_u64(s) >> 32;
+}
+
+/*********************************************************************
+** Function: random_below
+** Description: Returns an unbiased random integer from 0 to n - 1,
+**   using a multiply and a rarely taken rejection step instead of the
+**   biased (and slower) rand() % n.
+** Parameters: RandomStream *s - the stream.
+**             uint32_t n - the number of possible values.
+** Pre-Conditions: n is positive.
+** Post-Conditions: The stream has advanced by at least one value.
+** Return: An integer from 0 to n - 1, each equally likely.
+*********************************************************************/
+inline uint32_t random_below(RandomStream *s, uint32_t n) {
+    uint64_t product = (uint64_t)random_u32(s) * n;
+    uint32_t low = (uint32_t)product;
+    if (low < n) {
+        uint32_t threshold = (0u - n) % n;
+        while (low < threshold) {
+            product = (uint64_t)random_u32(s) * n;
+            low = (uint32_t)product;
+        }
+    }
+    return product >> 32;
+}
+
+/*********************************************************************
+** Function: random_unit
+** Description: Returns a random real number in [0, 1).
+** Parameters: RandomStream *s - the stream.
+** Pre-Conditions: s was created by make_stream.
+** Post-Conditions: The stream has advanced by one value.
+** Return: A uniformly distributed double in [0, 1).
+*********************************************************************/
+inline double random_unit(RandomStream *s) {
+    return (random_u64(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*********************************************************************
+** Function: time_seed
+** Description: Makes a seed from the current time, for runs that were
+**   not given an explicit seed.
+** Parameters: N/A
+** Pre-Conditions: N/A
+** Post-Conditions: N/A
+** Return: A seed that differs from run to run.
+*********************************************************************/
+inline uint64_t time_seed() {
+    return random_mix((uint64_t)time(NULL) * RANDOM_GOLDEN + (uint64_t)clock());
+}
+
+#endif